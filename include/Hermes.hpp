@@ -1,20 +1,35 @@
 #pragma once
 
+#include <map>
+#include <list>
 #include <mutex>
+#include <deque>
+#include <random>
 #include <atomic>
+#include <future>
 #include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
+#include <cstdint>
 #include <iostream>
+#include <algorithm>
 #include <stdexcept>
 #include <functional>
+#include <unordered_map>
 #include <condition_variable>
 
 #include "asio.hpp"
 #include "google/protobuf/message.h"
 
+// co_await-able operations are provided when the compiler supports the C++20
+// coroutines.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define HERMES_COROUTINES
+#endif
+
 namespace hermes {
 
 /**
@@ -30,6 +45,29 @@ namespace core {
 // Modify the value if you need a bigger size.
 static unsigned int const BUFFER_SIZE = 2048;
 
+// Size used for datagram buffers.
+// This is the largest payload an UDP datagram can carry over IPv4.
+static unsigned int const DATAGRAM_SIZE = 65507;
+
+// appends an unsigned integer to the buffer in network byte order.
+// used to build the binary headers of the hermes protocols.
+template <typename T>
+void put_integer(std::string& buffer, T value) {
+  for (int shift = 8 * (sizeof(T) - 1); shift >= 0; shift -= 8)
+    buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+}
+
+// reads an unsigned integer stored in network byte order at the given offset.
+// the caller has to check that the buffer is large enough.
+template <typename T>
+T get_integer(const std::string& buffer, std::size_t offset) {
+  T value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+    value = static_cast<T>((value << 8) |
+                           static_cast<unsigned char>(buffer[offset + i]));
+  return value;
+}
+
 /**
 *  @brief: Your program's link to your operating system I/O services.
 *
@@ -68,6 +106,7 @@ class Service {
   Service()
       : strand_(io_service_),
         stop_(false),
+        stopping_(false),
         work_(new asio::io_context::work(io_service_)) {}
 
   // CopyCtor
@@ -82,10 +121,18 @@ class Service {
   }
 
   // runs the service in his dedicated thread.
+  // Can be called concurrently: the thread is started once. A stopped
+  // service is restarted (e.g: a client reconnected after disconnect()),
+  // unless it is still stopping.
   void run() {
-    if (not stop_)
-      if (not thread_.joinable())
-        thread_ = std::thread([this]() { io_service_.run(); });
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ or thread_.joinable()) return;
+    if (stop_) {
+      io_service_.restart();
+      work_.reset(new asio::io_context::work(io_service_));
+      stop_ = false;
+    }
+    thread_ = std::thread([this]() { io_service_.run(); });
   }
 
   // asks the I/O service to execute the given handler.
@@ -95,16 +142,26 @@ class Service {
 
   // stops the service.
   void stop() {
-    if (not stop_) {
+    std::thread thread;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_) return;
       stop_ = true;
+      stopping_ = true;
       work_.reset();
-      if (thread_.joinable())
-        thread_.join();
-      else {
-        io_service_.run();
-        io_service_.stop();
-      }
+      thread = std::move(thread_);
+    }
+
+    // joined without the lock, the pending handlers may call run().
+    if (thread.joinable())
+      thread.join();
+    else {
+      io_service_.run();
+      io_service_.stop();
     }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
   }
 
   // returns the state of the service.
@@ -123,9 +180,15 @@ class Service {
   // Dedicated thread to call the run() method.
   std::thread thread_;
 
+  // Protects the start and the stop of the thread.
+  std::mutex mutex_;
+
   // Indicates if the service is stopped.
   std::atomic<bool> stop_;
 
+  // Indicates if the service is stopping, it cannot be restarted meanwhile.
+  bool stopping_;
+
   // I/O services.
   asio::io_context io_service_;
 
@@ -140,6 +203,379 @@ class Service {
   std::unique_ptr<asio::io_context::work> work_;
 };
 
+/**
+*  @brief: Pool of I/O services.
+*
+*  @description: each Service runs its own thread. Instead of giving a
+*  dedicated Service to each connection, a ServicePool runs a handful of
+*  services and hands them out in a round-robin fashion, so that thousands of
+*  connections (e.g: tcp::Client constructed against a shared service) share
+*  a few event loop threads.
+*
+*  @code: c++
+*   hermes::core::ServicePool pool(4);
+*   hermes::tcp::Client client("127.0.0.1", "8080", pool.next());
+*  @endcode
+*
+*/
+class ServicePool {
+ public:
+  // Ctor
+  // runs the given number of services, at least one.
+  explicit ServicePool(
+      std::size_t size = std::max(1u, std::thread::hardware_concurrency()))
+      : next_(0) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(size, 1); ++i) {
+      services_.emplace_back(new Service);
+      services_.back()->run();
+    }
+  }
+
+  // CopyCtor
+  ServicePool(const ServicePool&) = delete;
+  // Assignment operator
+  ServicePool& operator=(const ServicePool&) = delete;
+
+  // Dtor
+  ~ServicePool() { stop(); }
+
+  // returns the next service, in a round-robin fashion.
+  Service& next() { return *services_[next_++ % services_.size()]; }
+
+  // stops all the services, waiting for their pending operations.
+  void stop() {
+    for (auto& service : services_) service->stop();
+  }
+
+  // returns the number of services.
+  std::size_t size() const { return services_.size(); }
+
+ private:
+  // The services.
+  std::vector<std::unique_ptr<Service>> services_;
+
+  // Index of the next service to hand out.
+  std::atomic<std::size_t> next_;
+};
+
+/**
+*  @brief: Exponential backoff with jitter.
+*
+*  @description: Backoff computes the delays between the retries of an
+*  operation (e.g: a reconnection). The ceiling of the delay doubles at each
+*  attempt, from initial to max, and the delay is drawn randomly between the
+*  half of the ceiling and the ceiling. The jitter spreads the retries of many
+*  clients disconnected at the same time, instead of hitting the restarting
+*  server in waves.
+*
+*/
+class Backoff {
+ public:
+  // Ctor
+  explicit Backoff(
+      const std::chrono::milliseconds& initial = std::chrono::milliseconds(100),
+      const std::chrono::milliseconds& max = std::chrono::seconds(30))
+      : initial_(std::max<std::chrono::milliseconds::rep>(initial.count(), 1)),
+        max_(std::max(initial_, max)),
+        attempts_(0),
+        random_(std::random_device{}()) {}
+
+  // returns the delay before the next attempt.
+  std::chrono::milliseconds next() {
+    auto ceiling = initial_;
+
+    for (std::size_t i = 0; i < attempts_ and ceiling < max_; ++i)
+      ceiling *= 2;
+    ceiling = std::min(ceiling, max_);
+    ++attempts_;
+
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(
+        ceiling.count() / 2, ceiling.count());
+    return std::chrono::milliseconds(jitter(random_));
+  }
+
+  // starts over from the initial delay, e.g: once the operation succeeded.
+  void reset() { attempts_ = 0; }
+
+  // returns the number of attempts since the last reset.
+  std::size_t attempts() const { return attempts_; }
+
+ private:
+  // The first ceiling.
+  std::chrono::milliseconds initial_;
+  // The maximum ceiling.
+  std::chrono::milliseconds max_;
+  // Number of attempts since the last reset.
+  std::size_t attempts_;
+  // Source of the jitter.
+  std::mt19937 random_;
+};
+
+/**
+*  @brief: Circuit breaker
+*
+*  @description: CircuitBreaker stops calling a server which is failing, so
+*  that the calls fail immediately instead of waiting for timeouts.
+*  The breaker is closed while the server works. It opens once the ratio of
+*  failed calls (errors and calls slower than the slow threshold) over the
+*  last calls reaches the failure ratio: the calls are then refused. After
+*  the open duration, the breaker is half-open and lets a probe call through:
+*  the breaker closes if the probe succeeds, or opens again otherwise.
+*  CircuitBreaker::of returns the breaker of an endpoint, shared by the
+*  clients of this endpoint.
+*
+*/
+class CircuitBreaker {
+ public:
+  enum State { CLOSED, OPEN, HALF_OPEN };
+
+  // Ctor
+  //
+  //  @param:
+  //    - ratio, of failed calls opening the breaker.
+  //    - window, the number of last calls considered, the breaker does not
+  //      open before window calls have been made.
+  //    - open, the duration during which the calls are refused.
+  //    - slow, the latency above which a call is failed, zero to disable.
+  explicit CircuitBreaker(
+      double ratio = 0.5, std::size_t window = 20,
+      const std::chrono::milliseconds& open = std::chrono::seconds(5),
+      const std::chrono::milliseconds& slow = std::chrono::milliseconds(0))
+      : ratio_(ratio),
+        window_(std::max<std::size_t>(window, 1)),
+        open_(open),
+        slow_(slow),
+        state_(CLOSED),
+        failures_(0),
+        probing_(false) {}
+
+  // returns the breaker of the given endpoint (e.g: "host:port"), shared by
+  // all its clients. It is created with the default settings.
+  static std::shared_ptr<CircuitBreaker> of(const std::string& endpoint) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<CircuitBreaker>> breakers;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& breaker = breakers[endpoint];
+    if (not breaker) breaker = std::make_shared<CircuitBreaker>();
+    return breaker;
+  }
+
+  // returns true whether the call can be made. Once the open duration is
+  // over, a single probe call is allowed until its outcome is known.
+  bool allow() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == OPEN and std::chrono::steady_clock::now() >= until_)
+      state_ = HALF_OPEN;
+    if (state_ == CLOSED) return true;
+    if (state_ == OPEN or probing_) return false;
+    probing_ = true;
+    return true;
+  }
+
+  // records a successful call and its latency.
+  void success(const std::chrono::steady_clock::duration& latency =
+                   std::chrono::steady_clock::duration::zero()) {
+    if (slow_.count() and latency > slow_) return failure();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == HALF_OPEN) {
+      reset(CLOSED);
+      return;
+    }
+    record(false);
+  }
+
+  // records a failed call.
+  void failure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == HALF_OPEN) {
+      trip();
+      return;
+    }
+    record(true);
+    if (calls_.size() == window_ and failures_ >= ratio_ * window_) trip();
+  }
+
+  // returns the state of the breaker.
+  State state() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == OPEN and std::chrono::steady_clock::now() >= until_)
+      return HALF_OPEN;
+    return state_;
+  }
+
+ private:
+  // records the outcome of a call in the window. mutex_ must be locked.
+  void record(bool failed) {
+    calls_.push_back(failed);
+    failures_ += failed;
+    if (calls_.size() > window_) {
+      failures_ -= calls_.front();
+      calls_.pop_front();
+    }
+  }
+
+  // opens the breaker. mutex_ must be locked.
+  void trip() {
+    reset(OPEN);
+    until_ = std::chrono::steady_clock::now() + open_;
+  }
+
+  // changes the state and forgets the calls. mutex_ must be locked.
+  void reset(State state) {
+    state_ = state;
+    probing_ = false;
+    failures_ = 0;
+    calls_.clear();
+  }
+
+  // Ratio of failed calls opening the breaker.
+  double ratio_;
+  // Number of calls considered.
+  std::size_t window_;
+  // Duration during which the calls are refused.
+  std::chrono::milliseconds open_;
+  // Latency above which a call is failed.
+  std::chrono::milliseconds slow_;
+  // Protects the state.
+  std::mutex mutex_;
+  // The state of the breaker.
+  State state_;
+  // The outcome of the last calls, true if failed.
+  std::deque<bool> calls_;
+  // Number of failed calls in the window.
+  std::size_t failures_;
+  // Indicates if the probe call is in progress.
+  bool probing_;
+  // The end of the open duration.
+  std::chrono::steady_clock::time_point until_;
+};
+
+/**
+*  @brief: Bounded cache of responses
+*
+*  @description: Cache keeps the last responses by key (a request payload or
+*  a key chosen by the user), so that an idempotent request already answered
+*  does not reach the network. It holds at most capacity entries, the least
+*  recently used one is evicted first, and an entry expires after the time to
+*  live. The hits and misses are counted to tune its size.
+*  It is thread safe.
+*
+*/
+class Cache {
+ public:
+  // Ctor
+  explicit Cache(std::size_t capacity = 1024,
+                 const std::chrono::milliseconds& ttl = std::chrono::seconds(60))
+      : capacity_(std::max<std::size_t>(capacity, 1)),
+        ttl_(ttl),
+        hits_(0),
+        misses_(0) {}
+
+  // Copy Ctor
+  Cache(const Cache&) = delete;
+  // Assignment operator
+  Cache& operator=(const Cache&) = delete;
+
+  // returns true and sets value whether a live entry is cached for the key.
+  bool get(const std::string& key, std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it == index_.end() or
+        it->second->expiry <= std::chrono::steady_clock::now()) {
+      if (it != index_.end()) erase(it);
+      ++misses_;
+      return false;
+    }
+    // most recently used first.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    value = it->second->value;
+    ++hits_;
+    return true;
+  }
+
+  // caches the value of the key, evicting the least recently used entry if
+  // the cache is full.
+  void put(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) erase(it);
+    if (index_.size() >= capacity_) erase(index_.find(entries_.back().key));
+
+    entries_.push_front(
+        Entry{key, value, std::chrono::steady_clock::now() + ttl_});
+    index_[key] = entries_.begin();
+  }
+
+  // removes the entry of the key, if any.
+  void invalidate(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) erase(it);
+  }
+
+  // removes all the entries.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    entries_.clear();
+  }
+
+  // returns the number of entries, expired ones included.
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+  }
+
+  // returns the number of lookups answered from the cache.
+  std::size_t hits() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+  }
+
+  // returns the number of lookups not answered from the cache.
+  std::size_t misses() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  typedef std::unordered_map<std::string, std::list<Entry>::iterator> Index;
+
+  void erase(Index::iterator it) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  // Maximum number of entries.
+  std::size_t capacity_;
+  // Time to live of the entries.
+  std::chrono::milliseconds ttl_;
+  // Protects the entries and the counters.
+  std::mutex mutex_;
+  // The entries, most recently used first.
+  std::list<Entry> entries_;
+  // The entries by key.
+  Index index_;
+  // Number of lookups answered.
+  std::size_t hits_;
+  // Number of lookups not answered.
+  std::size_t misses_;
+};
+
 /**
 *  @brief: Errors handling class
 *
@@ -240,6 +676,126 @@ class Error {
   asio::error_code error_;
 };
 
+// completes the promise of a future-returning operation, from the I/O thread,
+// with the value or with the error as an asio::system_error exception.
+template <typename T>
+void complete(std::promise<T>& promise, const asio::error_code& error,
+              T value) {
+  if (error)
+    promise.set_exception(std::make_exception_ptr(asio::system_error(error)));
+  else
+    promise.set_value(std::move(value));
+}
+
+#ifdef HERMES_COROUTINES
+
+/**
+*  @brief: C++20 coroutines support
+*
+*  @description: Awaitable turns an asynchronous asio operation into an object
+*  which can be co_await-ed. The operation is started when the coroutine is
+*  suspended, and the coroutine is resumed from the I/O thread, by the
+*  completion handler, with the result of the operation. No thread is parked
+*  waiting for the operation, and the request/response logic can be written
+*  as straight-line code.
+*  An error is thrown as an asio::system_error from the co_await expression.
+*
+*  Task is a detached coroutine type, to run such a straight-line code:
+*
+*  @code: c++
+*   hermes::core::Task ping(hermes::tcp::Client& client) {
+*     co_await client.co_connect();
+*     co_await client.co_send("ping");
+*     std::string pong = co_await client.co_receive();
+*   }
+*  @endcode
+*
+*/
+template <typename Result, typename Initiation>
+class Awaitable {
+ public:
+  explicit Awaitable(Initiation initiation)
+      : initiation_(std::move(initiation)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // the coroutine may be resumed, and this object destroyed, before the
+    // initiation returns. Nothing of this object is used past this point.
+    auto initiation = std::move(initiation_);
+    initiation([this, handle](const asio::error_code& error, Result result) {
+      error_ = error;
+      result_ = std::move(result);
+      handle.resume();
+    });
+  }
+
+  Result await_resume() {
+    if (error_) throw asio::system_error(error_);
+    return std::move(result_);
+  }
+
+ private:
+  Initiation initiation_;
+  asio::error_code error_;
+  Result result_;
+};
+
+// Awaitable of an operation without result (e.g: connect).
+template <typename Initiation>
+class Awaitable<void, Initiation> {
+ public:
+  explicit Awaitable(Initiation initiation)
+      : initiation_(std::move(initiation)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto initiation = std::move(initiation_);
+    initiation([this, handle](const asio::error_code& error) {
+      error_ = error;
+      handle.resume();
+    });
+  }
+
+  void await_resume() {
+    if (error_) throw asio::system_error(error_);
+  }
+
+ private:
+  Initiation initiation_;
+  asio::error_code error_;
+};
+
+// builds an Awaitable from the function starting the asynchronous operation.
+// the function receives the completion handler to invoke with the result.
+template <typename Result, typename Initiation>
+Awaitable<Result, Initiation> make_awaitable(Initiation initiation) {
+  return Awaitable<Result, Initiation>(std::move(initiation));
+}
+
+// Detached coroutine. It starts immediately and its frame is released once
+// it is completed. An exception escaping the coroutine is printed.
+struct Task {
+  struct promise_type {
+    Task get_return_object() noexcept { return Task(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() {
+      try {
+        throw;
+      } catch (std::exception& e) {
+        Error::print(e.what());
+      } catch (...) {
+        Error::print("Unexpected error occurred in a coroutine.");
+      }
+    }
+  };
+};
+
+#endif  // HERMES_COROUTINES
+
 }  // namespace core
 
 /**
@@ -259,6 +815,306 @@ class Error {
 */
 namespace network {
 
+/**
+*   @brief: Asynchronous name resolution with a cache.
+*
+*   @description: Resolver resolves host:port asynchronously, on its own I/O
+*   thread, and caches the endpoints so that the connections do not wait for
+*   the DNS on each call. The concurrent resolutions of a same host:port are
+*   coalesced into one.
+*   getaddrinfo does not expose the TTL of the DNS records, so the entries
+*   expire after a configurable time to live (60 seconds by default), to be
+*   set according to the TTL of your records. The expired entries are
+*   evicted once per time to live.
+*   The callbacks are always invoked from the I/O thread of the resolver,
+*   even when the endpoints are cached.
+*   Resolver::shared() is the resolver used by the tcp clients.
+*
+*/
+class Resolver {
+ public:
+  typedef std::vector<asio::ip::tcp::endpoint> endpoints;
+
+  // invoked with the endpoints of the host, or with the error of the
+  // resolution.
+  typedef std::function<void(const asio::error_code&, const endpoints&)>
+      callback;
+
+  // Ctor
+  explicit Resolver(
+      const std::chrono::milliseconds& ttl = std::chrono::seconds(60))
+      : ttl_(ttl),
+        next_prune_(std::chrono::steady_clock::now() + ttl),
+        resolver_(service_.get()) {
+    service_.run();
+  }
+
+  // Copy Ctor
+  Resolver(const Resolver&) = delete;
+  // Assignment operator
+  Resolver& operator=(const Resolver&) = delete;
+
+  // Dtor
+  ~Resolver() noexcept {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      resolver_.cancel();
+    }
+    service_.stop();
+  }
+
+  // returns the resolver shared by the clients.
+  static Resolver& shared() {
+    static Resolver resolver;
+    return resolver;
+  }
+
+  // asynchronous resolution of host:port.
+  // the callback is invoked from the I/O thread of the resolver, right away
+  // if the endpoints are cached, otherwise once resolved. Never from the
+  // calling thread, so it can take the locks held by the caller.
+  void async_resolve(const std::string& host, const std::string& port,
+                     const callback& callback) {
+    auto key = host + ":" + port;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    prune();
+    auto& entry = cache_[key];
+
+    if (fresh(entry)) {
+      auto endpoints = entry.list;
+      service_.post([callback, endpoints]() {
+        callback(asio::error_code(), endpoints);
+      });
+      return;
+    }
+
+    // a resolution of host:port is already in progress.
+    entry.waiting.push_back(callback);
+    if (entry.waiting.size() > 1) return;
+
+    resolver_.async_resolve(
+        host, port, [this, key](const asio::error_code& error,
+                                asio::ip::tcp::resolver::results_type results) {
+          resolved(key, error, endpoints(results.begin(), results.end()));
+        });
+  }
+
+  // synchronous resolution of host:port, only waits on a cache miss.
+  // throws asio::system_error if the resolution fails.
+  endpoints resolve(const std::string& host, const std::string& port) {
+    auto key = host + ":" + port;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = cache_.find(key);
+      if (found != cache_.end() and fresh(found->second))
+        return found->second.list;
+    }
+
+    // from a callback, the I/O thread would wait for itself: resolves on
+    // the calling thread instead.
+    if (service_.get().get_executor().running_in_this_thread()) {
+      asio::ip::tcp::resolver resolver(service_.get());
+      auto results = resolver.resolve(host, port);
+      endpoints list(results.begin(), results.end());
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& entry = cache_[key];
+      entry.list = list;
+      entry.expiry = std::chrono::steady_clock::now() + ttl_;
+      return list;
+    }
+
+    std::promise<endpoints> promise;
+
+    async_resolve(host, port, [&promise](const asio::error_code& error,
+                                         const endpoints& endpoints) {
+      core::complete(promise, error, endpoints);
+    });
+    return promise.get_future().get();
+  }
+
+  // sets the time to live of the entries resolved from now on.
+  void set_ttl(const std::chrono::milliseconds& ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = ttl;
+  }
+
+  // drops the cached entries, e.g: after a failover of the servers.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.waiting.empty())
+        it = cache_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+ private:
+  // The endpoints of a host:port.
+  struct Entry {
+    endpoints list;
+    std::chrono::steady_clock::time_point expiry;
+    // The callbacks waiting for the resolution in progress.
+    std::vector<callback> waiting;
+  };
+
+  // returns true whether the endpoints of the entry are cached and not
+  // expired.
+  static bool fresh(const Entry& entry) {
+    return not entry.list.empty() and
+           std::chrono::steady_clock::now() < entry.expiry;
+  }
+
+  // evicts the entries expired (or failed) without resolution in progress,
+  // at most once per time to live. mutex_ must be locked.
+  void prune() {
+    auto now = std::chrono::steady_clock::now();
+
+    if (now < next_prune_) return;
+    next_prune_ = now + ttl_;
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.waiting.empty() and not fresh(it->second))
+        it = cache_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  // caches the endpoints and completes the waiting callbacks.
+  // Runs in the I/O thread of the resolver.
+  void resolved(const std::string& key, const asio::error_code& error,
+                const endpoints& endpoints) {
+    std::vector<callback> waiting;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& entry = cache_[key];
+
+      waiting.swap(entry.waiting);
+      if (not error) {
+        entry.list = endpoints;
+        entry.expiry = std::chrono::steady_clock::now() + ttl_;
+      }
+    }
+    for (auto& callback : waiting) callback(error, endpoints);
+  }
+
+  // The time to live of the entries.
+  std::chrono::milliseconds ttl_;
+  // Time of the next eviction of the expired entries.
+  std::chrono::steady_clock::time_point next_prune_;
+  // I/O services, runs the resolutions.
+  core::Service service_;
+  // Protects the cache and the asio resolver.
+  std::mutex mutex_;
+  // The entries, by host:port.
+  std::unordered_map<std::string, Entry> cache_;
+  // The asio resolver.
+  asio::ip::tcp::resolver resolver_;
+};
+
+// integer option of the TCP level, for the options asio does not provide
+// (e.g: TCP_FASTOPEN). Passed to set_option, as the options of asio.
+template <int Name>
+class tcp_option {
+ public:
+  // Ctor
+  explicit tcp_option(int value) : value_(value) {}
+
+  template <typename Protocol>
+  int level(const Protocol&) const {
+    return IPPROTO_TCP;
+  }
+
+  template <typename Protocol>
+  int name(const Protocol&) const {
+    return Name;
+  }
+
+  template <typename Protocol>
+  const int* data(const Protocol&) const {
+    return &value_;
+  }
+
+  template <typename Protocol>
+  std::size_t size(const Protocol&) const {
+    return sizeof(value_);
+  }
+
+ private:
+  // The value of the option.
+  int value_;
+};
+
+/**
+*   @brief: Options of the TCP sockets
+*
+*   @description: SocketOptions gathers the tuning of a connection, applied
+*   by Stream before its connection, and by tcp::Server to every session it
+*   accepts. The options left to their default value are not set, and the
+*   options not supported by the system are ignored.
+*
+*   @code: c++
+*    hermes::network::SocketOptions latency;
+*    latency.no_delay = true;
+*    latency.quick_ack = true;
+*
+*    server.set_options(latency);
+*    client.set_options(latency);
+*  @endcode
+*
+*/
+struct SocketOptions {
+  // disables the Nagle algorithm (TCP_NODELAY): the small messages are sent
+  // immediately instead of being coalesced.
+  bool no_delay = false;
+  // size of the kernel send buffer (SO_SNDBUF) in bytes, 0 for the default.
+  int send_buffer = 0;
+  // size of the kernel receive buffer (SO_RCVBUF) in bytes, 0 for the
+  // default. Set before the connection, it allows a larger window.
+  int receive_buffer = 0;
+  // acknowledges the data immediately instead of delaying the ACK
+  // (TCP_QUICKACK). The kernel can leave this mode, it is set at the
+  // connection only. Linux only.
+  bool quick_ack = false;
+  // probes the idle connections to detect a dead peer (SO_KEEPALIVE).
+  bool keep_alive = false;
+  // the connection is dropped once the data sent stay unacknowledged for
+  // this duration (TCP_USER_TIMEOUT), 0 for the default. Linux only.
+  std::chrono::milliseconds user_timeout = std::chrono::milliseconds(0);
+  // sends the data of the first send with the SYN (TCP_FASTOPEN_CONNECT),
+  // cf: Stream::set_fast_open. Client side only.
+  bool fast_open = false;
+
+  // sets the options on the socket, the errors are ignored.
+  template <typename Socket>
+  void apply(Socket& socket) const {
+    core::Error ignored;
+
+    if (no_delay)
+      socket.set_option(asio::ip::tcp::no_delay(true), ignored.get());
+    if (send_buffer)
+      socket.set_option(asio::socket_base::send_buffer_size(send_buffer),
+                        ignored.get());
+    if (receive_buffer)
+      socket.set_option(asio::socket_base::receive_buffer_size(receive_buffer),
+                        ignored.get());
+    if (keep_alive)
+      socket.set_option(asio::socket_base::keep_alive(true), ignored.get());
+#ifdef TCP_QUICKACK
+    if (quick_ack) socket.set_option(tcp_option<TCP_QUICKACK>(1), ignored.get());
+#endif
+#ifdef TCP_USER_TIMEOUT
+    if (user_timeout.count())
+      socket.set_option(
+          tcp_option<TCP_USER_TIMEOUT>(static_cast<int>(user_timeout.count())),
+          ignored.get());
+#endif
+  }
+};
+
 /**
 *   @brief: an asio::tcp::ip::socket wrapper to manage and serialize operations
 *   on the socket.
@@ -287,6 +1143,7 @@ class Stream : public std::enable_shared_from_this<Stream> {
   void connect(const asio::ip::tcp::endpoint& endpoint) {
     core::Error error;
 
+    prepare(socket_, endpoint);
     socket_.connect(endpoint, error.get());
     if (error.exist()) error.throw_it();
     connected_ = true;
@@ -295,6 +1152,9 @@ class Stream : public std::enable_shared_from_this<Stream> {
   // asynchronous connection to the given endpoint
   // a callback can be provided, it will be executed once the connection
   // established.
+  // async_connect returns immediately, the completion is only reported through
+  // the callback, or through the error handler if the connection failed. Many
+  // connections can thus be opened concurrently.
   //
   // @param:
   //    - endpoint
@@ -314,34 +1174,125 @@ class Stream : public std::enable_shared_from_this<Stream> {
   // @endcode
   void async_connect(const asio::ip::tcp::endpoint& endpoint,
                      const std::function<void(Stream&)>& callback = nullptr) {
-    if (connected_) return;
-
-    std::condition_variable condvar;
-    std::atomic_bool notified(false);
-
-    socket_.async_connect(endpoint, [&](const asio::error_code& error) {
+    if (connected_ or connecting_) return;
 
-      if (error) throw asio::system_error(error);
-      connected_ = true;
-      if (callback) callback(*this);
-      notified = true;
-      // notify that the connection has succeeded
-      condvar.notify_one();
+    async_connect(endpoint, [this, callback](const asio::error_code& error) {
+      if (error)
+        report(error);
+      else if (callback)
+        callback(*this);
     });
+  }
 
-    std::mutex mutex;
-    std::unique_lock<std::mutex> lock(mutex);
+  // asynchronous connection to the given endpoint, the completion receives
+  // the result of the operation instead of the error handler. It is invoked
+  // from the I/O thread, with already_started if the stream is connected or
+  // connecting. A closed stream can be connected again.
+  void async_connect(
+      const asio::ip::tcp::endpoint& endpoint,
+      const std::function<void(const asio::error_code&)>& completion) {
     service_.run();
-    if (not notified) condvar.wait(lock);
-  }
+    if (connected_ or connecting_.exchange(true)) {
+      service_.get_strand().post(
+          [completion]() { completion(asio::error::already_started); });
+      return;
+    }
 
-  // Stops the stream.
-  // @Note: does not stop the service.
+    auto roxanne(shared_from_this());
+
+    prepare(socket_, endpoint);
+    socket_.async_connect(
+        endpoint, service_.get_strand().wrap([this, roxanne, completion](
+                      const asio::error_code& error) {
+          connecting_ = false;
+
+          if (not error) {
+            connected_ = true;
+            closing_ = false;
+          }
+          completion(error);
+        }));
+  }
+
+  // asynchronous connection to the first of the endpoints accepting it
+  // (happy eyeballs, RFC 8305).
+  // The IPv6 and IPv4 endpoints are interleaved, and the attempts are
+  // staggered: a new attempt starts every delay, or as soon as the previous
+  // one failed, without cancelling the attempts in progress. The first
+  // connection established wins and the other attempts are cancelled. Thus a
+  // slow or unreachable address only delays the connection by the delay.
+  // The completion is invoked from the I/O thread, with the error of the last
+  // attempt if all of them failed.
+  void async_connect(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints,
+      const std::function<void(const asio::error_code&)>& completion,
+      const std::chrono::milliseconds& delay = std::chrono::milliseconds(250)) {
+    service_.run();
+    if (endpoints.empty() or connected_ or connecting_.exchange(true)) {
+      asio::error_code error = asio::error::already_started;
+      if (endpoints.empty()) error = asio::error::host_not_found;
+      service_.get_strand().post([completion, error]() { completion(error); });
+      return;
+    }
+
+    auto roxanne(shared_from_this());
+    auto race = std::make_shared<Race>(service_.get(), interleave(endpoints));
+
+    service_.get_strand().post([this, roxanne, race, completion, delay]() {
+      attempt(race, completion, delay);
+    });
+  }
+
+  // asynchronous connection to the first of the endpoints accepting it, a
+  // failure is reported to the error handler.
+  void async_connect(const std::vector<asio::ip::tcp::endpoint>& endpoints,
+                     const std::function<void(Stream&)>& callback = nullptr) {
+    async_connect(endpoints, [this, callback](const asio::error_code& error) {
+      if (error)
+        report(error);
+      else if (callback)
+        callback(*this);
+    });
+  }
+
+  // synchronous connection to the first of the endpoints accepting it, cf:
+  // async_connect. From an I/O thread of the stream (e.g: a handler), which
+  // cannot wait for the race, or when the service cannot run (e.g: still
+  // stopping), the endpoints are tried one after the other without delay.
+  void connect(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints,
+      const std::chrono::milliseconds& delay = std::chrono::milliseconds(250)) {
+    std::promise<asio::error_code> promise;
+    core::Error error;
+
+    service_.run();
+    if (service_.is_stop() or
+        service_.get().get_executor().running_in_this_thread()) {
+      connect_sequentially(endpoints);
+      return;
+    }
+
+    async_connect(endpoints, [&promise](const asio::error_code& error) {
+      promise.set_value(error);
+    }, delay);
+    error.get() = promise.get_future().get();
+    if (error.exist()) error.throw_it();
+  }
+
+  // Stops the stream.
+  // @Note: does not stop the service.
   void disconnect() {
     if (not connected_) return;
 
     connected_ = false;
 
+    // called from an handler running in the strand (e.g: a read handler),
+    // waiting for the strand to close the socket would never end.
+    if (service_.get_strand().running_in_this_thread()) {
+      close();
+      return;
+    }
+
     // To prevent some concurrency issues, the shutdown and close calls
     // are locked, waiting to be notified that one thread has completed the
     // tasks.
@@ -355,15 +1306,39 @@ class Stream : public std::enable_shared_from_this<Stream> {
     std::unique_lock<std::mutex> lock(mutex);
 
     std::atomic_bool notified(false);
-    service_.get_strand().post([this, &condvar, &notified]() {
-      core::Error error;
-      // asio error_code provided to ensure that no exception will be thrown.
-      socket_.shutdown(asio::ip::tcp::socket::shutdown_both);
-      socket_.close(error.get());
+    service_.get_strand().post([this, &mutex, &condvar, &notified]() {
+      close();
+      std::lock_guard<std::mutex> guard(mutex);
       notified = true;
       condvar.notify_one();
     });
-    if (not notified) condvar.wait(lock);
+    condvar.wait(lock, [&notified]() { return notified.load(); });
+  }
+
+  // Asynchronous and graceful close of the stream.
+  // The messages waiting in the write queue are sent first, then the sending
+  // side of the connection is shut down (half-close, the peer receives
+  // end-of-file). The input is read and discarded until the peer closes the
+  // connection too, or until the close timeout, then the socket is closed.
+  // The messages sent once the close started are dropped, cf: async_send.
+  // async_disconnect returns immediately, the callback is invoked from the
+  // I/O thread once the stream is closed. It can safely be called from any
+  // handler of the stream.
+  // @Note: does not stop the service.
+  void async_disconnect(const std::function<void(Stream&)>& callback = nullptr) {
+    auto roxanne(shared_from_this());
+
+    service_.get_strand().post([this, roxanne, callback]() {
+      if (closing_ or not socket_.is_open()) {
+        if (callback) callback(*this);
+        return;
+      }
+
+      connected_ = false;
+      closing_ = true;
+      close_handler_ = callback;
+      if (not writing_) graceful_close();
+    });
   }
 
   // Synchronous send of amount of data.
@@ -386,11 +1361,109 @@ class Stream : public std::enable_shared_from_this<Stream> {
   }
 
   // asynchronous send of amount of data
-  // Asks to strand to execute an asynchronous write on the socket.
+  // Asks to strand to queue the message. The messages are written one after
+  // the other, in the order of the calls.
+  // A message sent while the stream is closing or closed is dropped: the
+  // write handler is not invoked, the completion (cf: below) receives
+  // operation_aborted.
   void async_send(const std::string& message) {
-    // strand serializes the given handler
-    service_.get_strand().post(
-        std::bind(&Stream::async_send_handler, shared_from_this(), message));
+    async_send(message, nullptr);
+  }
+
+  // same as above, the completion is invoked from the I/O thread with the
+  // result of this send only, instead of the write handler.
+  //
+  // When no write is queued or in progress, the message is written
+  // immediately from the calling thread, as much as the socket buffer takes
+  // without blocking, saving the hops through the strand. Only the remainder,
+  // if any, is queued. The completion is still invoked from the I/O thread.
+  void async_send(
+      const std::string& message,
+      const std::function<void(const asio::error_code&, std::size_t)>&
+          completion) {
+    auto roxanne(shared_from_this());
+    std::size_t sent = 0;
+
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+
+      // held until flush.
+      if (batching_) {
+        batch_.push_back(Write{message, completion, 0});
+        return;
+      }
+
+      if (pending_writes_ == 0 and not closing_ and socket_.is_open())
+        sent = write_inline(message);
+
+      if (not message.empty() and sent == message.size()) {
+        if (completion or write_handler_)
+          service_.get_strand().post([this, roxanne, completion, sent]() {
+            if (completion)
+              completion(asio::error_code(), sent);
+            else if (write_handler_)
+              write_handler_(sent, *this);
+          });
+        return;
+      }
+
+      // strand serializes the given handler
+      ++pending_writes_;
+      service_.get_strand().post(std::bind(&Stream::async_send_handler,
+                                           roxanne, message.substr(sent),
+                                           completion, sent));
+    }
+  }
+
+  // starts a batch: the messages of the following asynchronous sends are held
+  // until flush, then written together, so that a logical message made of
+  // many pieces (e.g: a header and its body parts) leaves in full-sized
+  // segments instead of one small segment per piece. Where TCP_CORK is
+  // supported, the socket is also corked until the batch is written, which
+  // coalesces the synchronous sends of the batch as well, including when the
+  // batch starts before the connection.
+  // Closing the socket ends the batch: its messages are dropped and their
+  // completions receive operation_aborted.
+  // NOTE: the messages of a batch are only sent by flush.
+  void begin_batch() {
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+
+    if (batching_) return;
+    batching_ = true;
+    if (socket_.is_open()) cork(true);
+  }
+
+  // ends the batch: the messages held are written with a single write, then
+  // the socket is uncorked. Returns immediately, the completions are invoked
+  // from the I/O thread.
+  void flush() {
+    auto roxanne(shared_from_this());
+    auto batch = std::make_shared<std::vector<Write>>();
+
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+    if (not batching_) return;
+    batching_ = false;
+    batch->swap(batch_);
+    pending_writes_ += batch->size();
+
+    service_.get_strand().post([this, roxanne, batch]() {
+      if (closing_ or not socket_.is_open()) {
+        for (auto& write : *batch) {
+          --pending_writes_;
+          if (write.completion)
+            write.completion(asio::error::operation_aborted, 0);
+        }
+        return;
+      }
+
+      uncork_ = true;
+      for (auto& write : *batch) write_queue_.push_back(std::move(write));
+      if (writing_) return;
+      if (write_queue_.empty())
+        uncork();
+      else
+        write_next();
+    });
   }
 
   // Synchronous receive.
@@ -415,10 +1488,16 @@ class Stream : public std::enable_shared_from_this<Stream> {
 
   // asynchronous receive of data
   // Asks to strand to execute an asynchronous read on the socket.
-  void async_receive() {
+  void async_receive() { async_receive(nullptr); }
+
+  // same as above, the completion is invoked from the I/O thread with the
+  // result of this receive only, instead of the read handler.
+  void async_receive(
+      const std::function<void(const asio::error_code&, std::string)>&
+          completion) {
     // strand serializes the given handler
-    service_.get_strand().post(
-        std::bind(&Stream::async_receive_handler, shared_from_this()));
+    service_.get_strand().post(std::bind(&Stream::async_receive_handler,
+                                         shared_from_this(), completion));
   }
 
   // sets the callback wich will be invoked by the asynchronous send.
@@ -433,9 +1512,113 @@ class Stream : public std::enable_shared_from_this<Stream> {
     read_handler_ = callback;
   }
 
+  // sets the callback wich will be invoked when an asynchronous operation
+  // fails. Without error handler, the error is printed.
+  void set_error_handler(
+      const std::function<void(const asio::error_code&, Stream&)>& callback) {
+    error_handler_ = callback;
+  }
+
+#ifdef HERMES_COROUTINES
+  // co_await-able connection to the given endpoint.
+  //
+  // @code: c++
+  //  co_await session->co_connect(endpoint);
+  // @endcode
+  auto co_connect(const asio::ip::tcp::endpoint& endpoint) {
+    auto roxanne(shared_from_this());
+
+    return core::make_awaitable<void>([this, roxanne, endpoint](auto done) {
+      prepare(socket_, endpoint);
+      socket_.async_connect(
+          endpoint, service_.get_strand().wrap(
+                        [this, roxanne, done](const asio::error_code& error) {
+                          if (not error) connected_ = true;
+                          done(error);
+                        }));
+    });
+  }
+
+  // co_await-able send, returns the number of bytes sent.
+  auto co_send(const std::string& message) {
+    auto roxanne(shared_from_this());
+    auto data = std::make_shared<std::string>(message);
+
+    return core::make_awaitable<std::size_t>([this, roxanne, data](auto done) {
+      asio::async_write(socket_, asio::buffer(*data),
+                        service_.get_strand().wrap(
+                            [roxanne, data, done](const asio::error_code& error,
+                                                  std::size_t bytes) {
+                              done(error, bytes);
+                            }));
+    });
+  }
+
+  // co_await-able receive, returns the data received.
+  // @Note: shares the buffer of async_receive, do not mix them concurrently.
+  auto co_receive() {
+    auto roxanne(shared_from_this());
+
+    return core::make_awaitable<std::string>([this, roxanne](auto done) {
+      socket_.async_read_some(
+          asio::buffer(buffer_, core::BUFFER_SIZE),
+          service_.get_strand().wrap([this, roxanne, done](
+              const asio::error_code& error, std::size_t bytes) {
+            done(error, std::string(buffer_, bytes));
+          }));
+    });
+  }
+#endif  // HERMES_COROUTINES
+
   // returns if the stream is connected.
   bool is_connected() { return connected_; }
 
+  // returns false whether the peer has closed the connection or the socket is
+  // in error. The data waiting to be read are not consumed.
+  // @Note: must not be called while an operation is running on the socket.
+  bool is_alive() {
+    if (not connected_ or not socket_.is_open()) return false;
+
+    core::Error error;
+    char byte;
+
+    socket_.non_blocking(true, error.get());
+    auto bytes = socket_.receive(asio::buffer(&byte, 1),
+                                 asio::socket_base::message_peek, error.get());
+    socket_.non_blocking(false);
+
+    if (error.get() == asio::error::would_block) return true;
+    return not error.exist() and bytes;
+  }
+
+  // enables TCP Fast Open on the connections made afterwards: the data of the
+  // first send leave with the SYN, saving a round trip, once the client got a
+  // cookie from the server (i.e: from the second connection to the server).
+  // The connection is then established without waiting for the server, and a
+  // connection failure is reported by the first send.
+  // The SYN data can be delivered twice to the server (RFC 7413, section 6):
+  // only enable it for idempotent first messages.
+  // Not used by a connection racing several endpoints, whose attempts would
+  // all succeed at once. Ignored where TCP_FASTOPEN_CONNECT is not supported
+  // (Linux >= 4.11).
+  void set_fast_open(bool enable) { options_.fast_open = enable; }
+
+  // sets the options of the socket, applied before the next connections.
+  // A connected (or accepted) socket gets them immediately, except fast_open.
+  void set_options(const SocketOptions& options) {
+    options_ = options;
+    if (socket_.is_open()) options_.apply(socket_);
+  }
+
+  // returns the options of the socket.
+  const SocketOptions& options() const { return options_; }
+
+  // sets the time given to the peer to close the connection after a
+  // graceful close (cf: async_disconnect), 1 second by default.
+  void set_close_timeout(const std::chrono::milliseconds& timeout) {
+    close_timeout_ = timeout;
+  }
+
   // returns the reference on the service used by the session.
   core::Service& service() { return service_; }
 
@@ -447,68 +1630,481 @@ class Stream : public std::enable_shared_from_this<Stream> {
   Stream(core::Service& service)
       : service_(service),
         connected_(false),
+        connecting_(false),
+        writing_(false),
+        closing_(false),
+        pending_writes_(0),
+        batching_(false),
+        uncork_(false),
+        close_handler_(nullptr),
+        close_timeout_(std::chrono::seconds(1)),
         socket_(service.get()),
         read_handler_(nullptr),
-        write_handler_(nullptr) {
+        write_handler_(nullptr),
+        error_handler_(nullptr) {
     std::memset(buffer_, 0, core::BUFFER_SIZE);
   }
 
-  // Performs the asio::async_write operation.
+  // reports the error of an asynchronous operation.
+  void report(const asio::error_code& error) {
+    if (error_handler_)
+      error_handler_(error, *this);
+    else
+      core::Error::print(error.message());
+  }
+
+  // A graceful close waiting for the end-of-file of the peer.
+  struct Linger {
+    explicit Linger(asio::io_context& io_context)
+        : done(false), timer(io_context) {}
+
+    // Indicates if the socket is closed.
+    bool done;
+    // Closes the socket if the peer does not close the connection in time.
+    asio::steady_timer timer;
+    // Receives the input discarded.
+    char buffer[core::BUFFER_SIZE];
+  };
+
+  // The connection attempts of a staggered connection.
+  struct Race {
+    Race(asio::io_context& io_context,
+         const std::vector<asio::ip::tcp::endpoint>& endpoints)
+        : endpoints(endpoints), next(0), pending(0), done(false),
+          generation(0), timer(io_context) {}
+
+    // The endpoints, in the order of the attempts.
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+    // Index of the next endpoint to try.
+    std::size_t next;
+    // Number of attempts in progress.
+    std::size_t pending;
+    // Indicates if the race is over.
+    bool done;
+    // Identifies the last timer armed, a late timer is ignored.
+    std::size_t generation;
+    // Starts the next attempt after the delay.
+    asio::steady_timer timer;
+    // The sockets of the attempts.
+    std::vector<std::shared_ptr<asio::ip::tcp::socket>> sockets;
+  };
+
+  // returns the endpoints with the address families interleaved, starting
+  // with the family of the first one. Their order is kept within a family.
+  static std::vector<asio::ip::tcp::endpoint> interleave(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints) {
+    std::vector<asio::ip::tcp::endpoint> first, second, interleaved;
+    auto v6 = endpoints.front().address().is_v6();
+
+    for (const auto& endpoint : endpoints)
+      (endpoint.address().is_v6() == v6 ? first : second).push_back(endpoint);
+    for (std::size_t i = 0; i < std::max(first.size(), second.size()); ++i) {
+      if (i < first.size()) interleaved.push_back(first[i]);
+      if (i < second.size()) interleaved.push_back(second[i]);
+    }
+    return interleaved;
+  }
+
+  // starts the next connection attempt of the race, and arms the timer
+  // starting the following one. Runs in the strand.
+  void attempt(const std::shared_ptr<Race>& race,
+               const std::function<void(const asio::error_code&)>& completion,
+               const std::chrono::milliseconds& delay) {
+    auto roxanne(shared_from_this());
+    auto socket = std::make_shared<asio::ip::tcp::socket>(service_.get());
+
+    race->sockets.push_back(socket);
+    ++race->pending;
+    // with fast open, the first attempt would always win without reaching
+    // the server.
+    prepare(*socket, race->endpoints[race->next],
+            race->endpoints.size() == 1);
+    socket->async_connect(
+        race->endpoints[race->next++],
+        service_.get_strand().wrap([this, roxanne, race, socket, completion,
+                                    delay](const asio::error_code& error) {
+          --race->pending;
+          if (race->done) return;
+
+          if (not error) {
+            core::Error ignored;
+
+            // the winner is adopted, the other attempts are cancelled.
+            race->done = true;
+            race->timer.cancel(ignored.get());
+            for (auto& other : race->sockets)
+              if (other != socket) other->close(ignored.get());
+            {
+              std::lock_guard<std::mutex> lock(inline_mutex_);
+              socket_.close(ignored.get());
+              socket_ = std::move(*socket);
+            }
+
+            connecting_ = false;
+            connected_ = true;
+            closing_ = false;
+            completion(error);
+            return;
+          }
+
+          // a failure starts the next attempt without waiting for the delay.
+          if (race->next < race->endpoints.size()) {
+            attempt(race, completion, delay);
+          } else if (race->pending == 0) {
+            race->done = true;
+            connecting_ = false;
+            completion(error);
+          }
+        }));
+
+    if (race->next == race->endpoints.size()) return;
+
+    auto generation = ++race->generation;
+    race->timer.expires_after(delay);
+    race->timer.async_wait(service_.get_strand().wrap(
+        [this, roxanne, race, generation, completion,
+         delay](const asio::error_code& error) {
+          if (error or race->done or generation != race->generation or
+              race->next == race->endpoints.size())
+            return;
+          attempt(race, completion, delay);
+        }));
+  }
+
+  // synchronous connection to the first of the endpoints accepting it, tried
+  // one after the other.
+  void connect_sequentially(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints) {
+    core::Error error;
+
+    if (endpoints.empty()) error.get() = asio::error::host_not_found;
+    if (connected_ or connecting_.exchange(true))
+      error.get() = asio::error::already_started;
+    if (error.exist()) error.throw_it();
+
+    for (const auto& endpoint : interleave(endpoints)) {
+      core::Error ignored;
+
+      // a socket which failed to connect cannot be reused.
+      error.get().clear();
+      socket_.close(ignored.get());
+      prepare(socket_, endpoint, endpoints.size() == 1);
+      socket_.connect(endpoint, error.get());
+      if (not error.exist()) break;
+    }
+
+    connecting_ = false;
+    if (error.exist()) error.throw_it();
+    connected_ = true;
+    closing_ = false;
+  }
+
+  // opens the socket before its connection to apply the connection options,
+  // fast open only if allowed. A batch started before the connection corks
+  // the socket. The options not supported are ignored.
+  void prepare(asio::ip::tcp::socket& socket,
+               const asio::ip::tcp::endpoint& endpoint,
+               bool fast_open = true) {
+    core::Error ignored;
+
+    if (not socket.is_open()) socket.open(endpoint.protocol(), ignored.get());
+    options_.apply(socket);
+#ifdef TCP_FASTOPEN_CONNECT
+    if (fast_open and options_.fast_open)
+      socket.set_option(tcp_option<TCP_FASTOPEN_CONNECT>(1), ignored.get());
+#endif
+#ifdef TCP_CORK
+    if (batching_) socket.set_option(tcp_option<TCP_CORK>(1), ignored.get());
+#endif
+  }
+
+  // Queues the message and starts writing if no write is in progress.
   // this function is post through the strand object to ensure that it
   // will be invoked once and at the good moment.
-  void async_send_handler(const std::string& message) {
+  void async_send_handler(
+      const std::string& message,
+      const std::function<void(const asio::error_code&, std::size_t)>&
+          completion,
+      std::size_t sent) {
+    if (closing_ or not socket_.is_open()) {
+      --pending_writes_;
+      if (completion) completion(asio::error::operation_aborted, sent);
+      return;
+    }
+
+    write_queue_.push_back(Write{message, completion, sent});
+    if (not writing_) write_next();
+  }
+
+  // writes as much of the message as the socket buffer takes, without
+  // blocking, and returns the number of bytes written. Called with the
+  // inline_mutex_ held, which keeps the socket open.
+  // Where MSG_NOSIGNAL is not available, nothing is written inline.
+  std::size_t write_inline(const std::string& message) {
+#ifdef MSG_NOSIGNAL
+    auto bytes = ::send(socket_.native_handle(), message.data(),
+                        message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    // on error (e.g: EAGAIN), the asynchronous write takes over.
+    if (bytes > 0) return static_cast<std::size_t>(bytes);
+#endif
+    return 0;
+  }
+
+  // Performs the asio::async_write operation of the queued messages, gathered
+  // in a single write (up to MAX_GATHER of them).
+  // Only one write is in progress at a time, so the messages are never
+  // interleaved on the socket. Runs in the strand.
+  void write_next() {
     auto roxanne(shared_from_this());
+    std::vector<asio::const_buffer> buffers;
+
+    for (const auto& write : write_queue_) {
+      if (buffers.size() == MAX_GATHER) break;
+      buffers.push_back(asio::buffer(write.data));
+    }
+
+    writing_ = true;
     asio::async_write(
-        socket_, asio::buffer(message),
-        service_.get_strand().wrap(
-            [this, roxanne](const asio::error_code& error, std::size_t bytes) {
+        socket_, buffers,
+        service_.get_strand().wrap([this, roxanne, buffers](
+                                       const asio::error_code& error,
+                                       std::size_t) {
+          writing_ = false;
+
+          if (error) {
+            fail_writes(error);
+          } else {
+            for (std::size_t i = 0; i < buffers.size(); ++i) {
+              auto completion = std::move(write_queue_.front().completion);
+              auto bytes = buffers[i].size() + write_queue_.front().sent;
+
+              write_queue_.pop_front();
+              --pending_writes_;
+              if (completion)
+                completion(error, bytes);
+              else if (write_handler_)
+                write_handler_(bytes, *this);
+            }
+          }
+
+          if (not write_queue_.empty())
+            write_next();
+          else if (closing_)
+            graceful_close();
+          else if (uncork_)
+            uncork();
+        }));
+  }
+
+  // sets or clears TCP_CORK, ignored where not supported.
+  void cork(bool enable) {
+#ifdef TCP_CORK
+    core::Error ignored;
+    socket_.set_option(tcp_option<TCP_CORK>(enable), ignored.get());
+#endif
+  }
+
+  // uncorks the socket once a batch is written, unless a new batch started.
+  // Runs in the strand.
+  void uncork() {
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+
+    uncork_ = false;
+    if (not batching_ and socket_.is_open()) cork(false);
+  }
+
+  // drops the queued messages, their completions receive the error.
+  // Runs in the strand.
+  void fail_writes(const asio::error_code& error) {
+    auto unhandled = false;
+
+    while (not write_queue_.empty()) {
+      auto completion = std::move(write_queue_.front().completion);
+      write_queue_.pop_front();
+      --pending_writes_;
+      if (completion)
+        completion(error, 0);
+      else
+        unhandled = true;
+    }
+    if (unhandled and error != asio::error::operation_aborted) report(error);
+  }
+
+  // half-closes the socket once the write queue is flushed, then reads and
+  // discards the input until the end-of-file of the peer (or the close
+  // timeout) before closing it. Closing a socket with unread input makes
+  // the kernel reset the connection, and the peer may lose what it has not
+  // read yet. Runs in the strand.
+  void graceful_close() {
+    auto roxanne(shared_from_this());
+    core::Error error;
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      socket_.shutdown(asio::ip::tcp::socket::shutdown_send, error.get());
+    }
+    if (error.exist()) {
+      finish_close(nullptr);
+      return;
+    }
+
+    auto linger = std::make_shared<Linger>(service_.get());
+    linger->timer.expires_after(close_timeout_);
+    linger->timer.async_wait(service_.get_strand().wrap(
+        [this, roxanne, linger](const asio::error_code& error) {
+          // the pending read is aborted by the close.
+          if (not error and not linger->done) finish_close(linger);
+        }));
+    drain(linger);
+  }
+
+  // reads and discards the input until the end-of-file. Runs in the strand.
+  void drain(const std::shared_ptr<Linger>& linger) {
+    auto roxanne(shared_from_this());
+
+    socket_.async_read_some(
+        asio::buffer(linger->buffer, core::BUFFER_SIZE),
+        service_.get_strand().wrap([this, roxanne, linger](
+                                       const asio::error_code& error,
+                                       std::size_t) {
+          if (linger->done) return;
+          if (error)
+            finish_close(linger);
+          else
+            drain(linger);
+        }));
+  }
+
+  // closes the socket and invokes the close handler. Runs in the strand.
+  void finish_close(const std::shared_ptr<Linger>& linger) {
+    core::Error error;
+
+    if (linger) {
+      linger->done = true;
+      linger->timer.cancel(error.get());
+    }
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      socket_.close(error.get());
+    }
+    abort_batch();
 
-              if (error) throw asio::system_error(error);
+    auto callback = std::move(close_handler_);
+    close_handler_ = nullptr;
+    if (callback) callback(*this);
+  }
 
-              if (not bytes)
-                throw core::Error::Write(
-                    "Unexpected error occurred. asio::async_write failed;");
+  // shuts down and closes the socket. Runs in the strand.
+  void close() {
+    core::Error error;
+    {
+      // an inline write never sees the descriptor closed under it.
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      // asio error_code provided to ensure that no exception will be thrown.
+      socket_.shutdown(asio::ip::tcp::socket::shutdown_both, error.get());
+      socket_.close(error.get());
+    }
+    if (not writing_) fail_writes(asio::error::operation_aborted);
+    abort_batch();
+  }
 
-              std::mutex mutex;
-              // lock the execution of the handler to guarantee the thread
-              // safety.
-              std::lock_guard<std::mutex> lock(mutex);
-              if (write_handler_) write_handler_(bytes, *shared_from_this());
-            }));
+  // ends the batch in progress once the socket is closed: its messages are
+  // dropped, their completions receive operation_aborted, and the next
+  // connection starts without batch. Runs in the strand.
+  void abort_batch() {
+    std::vector<Write> batch;
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      batching_ = false;
+      batch.swap(batch_);
+    }
+    for (auto& write : batch)
+      if (write.completion)
+        write.completion(asio::error::operation_aborted, 0);
   }
 
   // Performs an asynchronous read on the socket.
   // this function is post through the strand object to ensure that it
   // will be invoked once and at the good moment.
-  void async_receive_handler() {
+  void async_receive_handler(
+      const std::function<void(const asio::error_code&, std::string)>&
+          completion) {
     auto roxanne(shared_from_this());
     socket_.async_read_some(
         asio::buffer(buffer_, core::BUFFER_SIZE),
-        service_.get_strand().wrap(
-            [this, roxanne](const asio::error_code& error, std::size_t bytes) {
+        service_.get_strand().wrap([this, roxanne, completion](
+            const asio::error_code& error, std::size_t bytes) {
 
-              if (error) throw asio::system_error(error);
+          if (completion) {
+            completion(error, std::string(buffer_, bytes));
+            return;
+          }
 
-              if (not bytes)
-                throw core::Error::Read(
-                    "Unexpected error occurred. asio::async_read failed.");
+          if (error) {
+            if (error != asio::error::operation_aborted) report(error);
+            return;
+          }
 
-              std::mutex mutex;
-              std::lock_guard<std::mutex> lock(mutex);
-              // lock the execution of the handler to guarantee the thread
-              // safety.
-              if (read_handler_)
-                read_handler_(std::string(buffer_), *shared_from_this());
-              std::memset(buffer_, 0, core::BUFFER_SIZE);
-            }));
+          if (read_handler_)
+            read_handler_(std::string(buffer_, bytes), *this);
+        }));
   }
 
   // A reference on the service to perform I/O operations.
   core::Service& service_;
 
+  // The options of the socket.
+  SocketOptions options_;
+
   // Thread safe boolean to know if the stream is connected.
   std::atomic<bool> connected_;
 
+  // Thread safe boolean to know if an asynchronous connection is in progress.
+  std::atomic<bool> connecting_;
+
+  // A message waiting to be written and its optional completion.
+  struct Write {
+    std::string data;
+    std::function<void(const asio::error_code&, std::size_t)> completion;
+    // bytes of the message already written inline.
+    std::size_t sent;
+  };
+
+  // Messages waiting to be written, only accessed from the strand.
+  std::deque<Write> write_queue_;
+
+  // Indicates if a write is in progress, only accessed from the strand.
+  bool writing_;
+
+  // Indicates if a graceful close is in progress, only modified from the
+  // strand.
+  std::atomic<bool> closing_;
+
+  // Number of messages queued or waiting for the strand, the messages are
+  // written inline only when there is none.
+  std::atomic<std::size_t> pending_writes_;
+
+  // Held by the inline writes, and while the socket is closed or replaced.
+  std::mutex inline_mutex_;
+
+  // Indicates if a batch is in progress, cf: begin_batch.
+  std::atomic<bool> batching_;
+
+  // Messages of the batch in progress, protected by the inline_mutex_.
+  std::vector<Write> batch_;
+
+  // Indicates if the socket is uncorked once the write queue is flushed,
+  // only accessed from the strand.
+  bool uncork_;
+
+  // Maximum number of messages gathered in a single write.
+  static constexpr std::size_t MAX_GATHER = 64;
+
+  // Handler invoked once the graceful close is completed.
+  std::function<void(Stream&)> close_handler_;
+
+  // Time given to the peer to close the connection after a graceful close.
+  std::chrono::milliseconds close_timeout_;
+
   // TCP socket.
   asio::ip::tcp::socket socket_;
 
@@ -520,101 +2116,546 @@ class Stream : public std::enable_shared_from_this<Stream> {
 
   // Asynchronous send handler.
   std::function<void(std::size_t, Stream&)> write_handler_;
-};
 
-}  // namespace network
-
-/**
-*  @brief: The tcp namespace contains a Client and a Server class. It is the top
-*  level of users' interaction with hermes. By this, i mean that the user who
-*  wants a network software following the TCP protocol will use this dedicated
-*  namespace. The client and the server have been designed to be very simple to
-*  use, you will find usages examples in the documentation.
-*
-*  @require: hermes::core
-*            hermes::network::Stream
-*
-*/
-namespace tcp {
+  // Asynchronous operations error handler.
+  std::function<void(const asio::error_code&, Stream&)> error_handler_;
+};
 
 /**
-* @brief: TCP Client Class
+*   @brief: an asio::ip::udp::socket wrapper to manage and serialize operations
+*   on the socket.
 *
-* @param:
-*     - host (string)
-*     - port (string)
+*   @description: Datagram is the UDP counterpart of Stream. It owns an udp
+*   socket and rests on the given service to perform the asynchronous
+*   operations made by the user. As there is no connection with UDP, each
+*   received message is delivered with the endpoint of its sender.
+*   Datagram also exposes the multicast features of the socket (group
+*   membership, time to live, loopback and outbound interface) in order to
+*   reach every subscriber of a group with a single send.
 *
-* @link:
-*   https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
 */
-class Client {
+class Datagram : public std::enable_shared_from_this<Datagram> {
  public:
-  // Ctor
-  explicit Client(const std::string& host, const std::string& port)
-      : host_(host),
-        port_(port),
-        session_(network::Stream::new_session(service_)) {}
+  typedef std::shared_ptr<Datagram> session;
 
-  // Copy Ctor
-  Client(const Client&) = delete;
-  // Assignment operator
-  Client& operator=(const Client&) = delete;
+  // Creates a new UDP session.
+  static session new_session(core::Service& service) {
+    return session(new Datagram(service));
+  }
 
-  // Dtor
-  ~Client() noexcept { disconnect(); }
+  // opens the socket for the given protocol (udp::v4() or udp::v6()).
+  void open(const asio::ip::udp& protocol) {
+    core::Error error;
 
-  // performs a synchronous connection
-  void connect() {
-    try {
-      if (is_connected()) throw core::Error::User("Client Already connected.");
-      session_->service().run();
-      asio::ip::tcp::resolver resolver(service_.get());
-      session_->connect(
-          *resolver.resolve(asio::ip::tcp::resolver::query(host_, port_)));
-    } catch (std::exception& e) {
-      core::Error::print(e.what());
-    }
+    if (socket_.is_open()) return;
+    socket_.open(protocol, error.get());
+    if (error.exist()) error.throw_it();
   }
 
-  // performs an asynchronous connection
-  //
-  //  @param:
-  //    - callback
-  //
-  //  A callback could be provided and it will be invoked when the asynchronous
-  //  connection will be completed.
-  void async_connect(
-      const std::function<void(network::Stream&)>& callback = nullptr) {
-    try {
-      if (is_connected()) throw core::Error::User("Client Already connected.");
-      asio::ip::tcp::resolver resolver(service_.get());
-      session_->async_connect(
-          *resolver.resolve(asio::ip::tcp::resolver::query(host_, port_)),
-          callback);
+  // binds the socket to the given local endpoint.
+  // reuse_address allows many sockets of the host to share the same port,
+  // which is required to have several multicast subscribers on one host.
+  void bind(const asio::ip::udp::endpoint& endpoint,
+            bool reuse_address = false) {
+    core::Error error;
+
+    open(endpoint.protocol());
+    if (reuse_address)
+      socket_.set_option(asio::ip::udp::socket::reuse_address(true));
+    socket_.bind(endpoint, error.get());
+    if (error.exist()) error.throw_it();
+  }
+
+  // connects the socket to the given peer.
+  // a connected socket only receives the datagrams of its peer and can use
+  // send instead of send_to.
+  void connect(const asio::ip::udp::endpoint& endpoint) {
+    core::Error error;
+
+    open(endpoint.protocol());
+    socket_.connect(endpoint, error.get());
+    if (error.exist()) error.throw_it();
+  }
+
+  // closes the socket, pending asynchronous operations are cancelled.
+  void close() {
+    core::Error error;
+    socket_.close(error.get());
+  }
+
+  // Synchronous send of a datagram to the connected peer.
+  std::size_t send(const std::string& message) {
+    core::Error error;
+
+    auto bytes =
+        socket_.send(asio::buffer(message.data(), message.size()), 0,
+                     error.get());
+
+    if (error.exist()) error.throw_it();
+    return bytes;
+  }
+
+  // Synchronous send of a datagram to the given endpoint.
+  std::size_t send_to(const std::string& message,
+                      const asio::ip::udp::endpoint& endpoint) {
+    core::Error error;
+
+    open(endpoint.protocol());
+    auto bytes = socket_.send_to(asio::buffer(message.data(), message.size()),
+                                 endpoint, 0, error.get());
+
+    if (error.exist()) error.throw_it();
+
+    if (bytes != message.size())
+      throw core::Error::Write(
+          "Unexpected error occurred: send_to failed. All data have not "
+          "been sent.");
+    return bytes;
+  }
+
+  // asynchronous send of a datagram to the given endpoint.
+  // Asks to strand to execute an asynchronous send_to on the socket.
+  void async_send_to(const std::string& message,
+                     const asio::ip::udp::endpoint& endpoint) {
+    service_.get_strand().post(std::bind(&Datagram::async_send_handler,
+                                         shared_from_this(), message,
+                                         endpoint));
+  }
+
+  // Synchronous receive of a datagram.
+  // sender is filled with the endpoint of the peer which sent the datagram.
+  std::string receive_from(asio::ip::udp::endpoint& sender) {
+    core::Error error;
+    char buffer[core::DATAGRAM_SIZE];
+
+    auto bytes = socket_.receive_from(asio::buffer(buffer, core::DATAGRAM_SIZE),
+                                      sender, 0, error.get());
+
+    if (error.exist()) error.throw_it();
+    return std::string(buffer, bytes);
+  }
+
+  // asynchronous receive of a datagram.
+  // Asks to strand to execute an asynchronous receive_from on the socket.
+  void async_receive() {
+    service_.get_strand().post(
+        std::bind(&Datagram::async_receive_handler, shared_from_this()));
+  }
+
+  // sets the callback wich will be invoked by the asynchronous send.
+  void set_write_handler(
+      const std::function<void(std::size_t, Datagram&)>& callback) {
+    write_handler_ = callback;
+  }
+
+  // sets the callback wich will be invoked by the asynchronous receive.
+  void set_read_handler(
+      const std::function<void(std::string, const asio::ip::udp::endpoint&,
+                               Datagram&)>& callback) {
+    read_handler_ = callback;
+  }
+
+  // sets the callback wich will be invoked when an asynchronous receive
+  // fails (e.g: connection_refused, reported by ICMP on a connected socket).
+  // The handler decides whether to receive again. Without error handler, the
+  // error is printed and the receive is armed again: an UDP socket remains
+  // usable after such an error.
+  void set_error_handler(
+      const std::function<void(const asio::error_code&, Datagram&)>&
+          callback) {
+    error_handler_ = callback;
+  }
+
+  // joins the given multicast group.
+  // For IPv4 groups, the interface is designated by its address, for IPv6
+  // groups, by the scope id of the address (e.g: fe80::1%eth0).
+  // An unspecified interface lets the operating system choose it.
+  void join_group(const asio::ip::address& group,
+                  const asio::ip::address& interface = asio::ip::address()) {
+    socket_.set_option(membership<asio::ip::multicast::join_group>(
+        group, interface));
+  }
+
+  // leaves the given multicast group.
+  void leave_group(const asio::ip::address& group,
+                   const asio::ip::address& interface = asio::ip::address()) {
+    socket_.set_option(membership<asio::ip::multicast::leave_group>(
+        group, interface));
+  }
+
+  // sets the number of hops (time to live) of outgoing multicast datagrams.
+  void set_ttl(int hops) {
+    socket_.set_option(asio::ip::multicast::hops(hops));
+  }
+
+  // enables or disables the delivery of outgoing multicast datagrams to the
+  // sockets of the sending host.
+  void set_loopback(bool enable) {
+    socket_.set_option(asio::ip::multicast::enable_loopback(enable));
+  }
+
+  // selects the interface used to send multicast datagrams.
+  void set_interface(const asio::ip::address& interface) {
+    if (interface.is_v4())
+      socket_.set_option(
+          asio::ip::multicast::outbound_interface(interface.to_v4()));
+    else
+      socket_.set_option(asio::ip::multicast::outbound_interface(
+          static_cast<unsigned int>(interface.to_v6().scope_id())));
+  }
+
+  // returns the reference on the service used by the session.
+  core::Service& service() { return service_; }
+
+  // returns a reference on the socket used by the session.
+  asio::ip::udp::socket& socket() { return socket_; }
+
+ private:
+  // ctor
+  Datagram(core::Service& service)
+      : service_(service),
+        socket_(service.get()),
+        read_handler_(nullptr),
+        write_handler_(nullptr),
+        error_handler_(nullptr) {}
+
+  // builds the join/leave option matching the family of the group.
+  template <typename Option>
+  static Option membership(const asio::ip::address& group,
+                           const asio::ip::address& interface) {
+    if (group.is_v6())
+      return Option(group.to_v6(), interface.is_v6()
+                                       ? interface.to_v6().scope_id()
+                                       : 0);
+    if (interface.is_v4()) return Option(group.to_v4(), interface.to_v4());
+    return Option(group);
+  }
+
+  // Performs the asynchronous send_to operation.
+  // this function is post through the strand object to ensure that it
+  // will be invoked once and at the good moment.
+  void async_send_handler(const std::string& message,
+                          const asio::ip::udp::endpoint& endpoint) {
+    auto roxanne(shared_from_this());
+    auto data = std::make_shared<std::string>(message);
+
+    socket_.async_send_to(
+        asio::buffer(*data), endpoint,
+        service_.get_strand().wrap([this, roxanne, data](
+            const asio::error_code& error, std::size_t bytes) {
+
+          if (error) {
+            if (error != asio::error::operation_aborted)
+              core::Error::print(error.message());
+            return;
+          }
+
+          if (write_handler_) write_handler_(bytes, *this);
+        }));
+  }
+
+  // Performs an asynchronous receive_from on the socket.
+  // this function is post through the strand object to ensure that it
+  // will be invoked once and at the good moment.
+  void async_receive_handler() {
+    auto roxanne(shared_from_this());
+    socket_.async_receive_from(
+        asio::buffer(buffer_, core::DATAGRAM_SIZE), sender_,
+        service_.get_strand().wrap([this, roxanne](
+            const asio::error_code& error, std::size_t bytes) {
+
+          // the socket has been closed, nothing to deliver.
+          if (error == asio::error::operation_aborted) return;
+
+          if (not error) {
+            if (read_handler_)
+              read_handler_(std::string(buffer_, bytes), sender_, *this);
+          } else if (error_handler_) {
+            error_handler_(error, *this);
+          } else {
+            core::Error::print(error.message());
+            if (socket_.is_open()) async_receive_handler();
+          }
+        }));
+  }
+
+  // A reference on the service to perform I/O operations.
+  core::Service& service_;
+
+  // UDP socket.
+  asio::ip::udp::socket socket_;
+
+  // Endpoint of the sender of the last datagram received asynchronously.
+  asio::ip::udp::endpoint sender_;
+
+  // Buffer.
+  char buffer_[core::DATAGRAM_SIZE];
+
+  // Asynchronous receive handler.
+  std::function<void(std::string, const asio::ip::udp::endpoint&, Datagram&)>
+      read_handler_;
+
+  // Asynchronous send handler.
+  std::function<void(std::size_t, Datagram&)> write_handler_;
+
+  // Asynchronous receive error handler.
+  std::function<void(const asio::error_code&, Datagram&)> error_handler_;
+};
+
+}  // namespace network
+
+/**
+*  @brief: The tcp namespace contains a Client and a Server class. It is the top
+*  level of users' interaction with hermes. By this, i mean that the user who
+*  wants a network software following the TCP protocol will use this dedicated
+*  namespace. The client and the server have been designed to be very simple to
+*  use, you will find usages examples in the documentation.
+*
+*  @require: hermes::core
+*            hermes::network::Stream
+*
+*/
+namespace tcp {
+
+/**
+* @brief: TCP Client Class
+*
+* @param:
+*     - host (string)
+*     - port (string)
+*
+* @link:
+*   https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class Client {
+ public:
+  // Says whether the data received is a complete response.
+  typedef std::function<bool(const std::string&)> predicate;
+
+  // Ctor
+  // the client owns its service, and thus its I/O thread.
+  explicit Client(const std::string& host, const std::string& port)
+      : host_(host),
+        port_(port),
+        owned_service_(new core::Service),
+        service_(*owned_service_),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client runs on an externally owned service (e.g: taken from a
+  // core::ServicePool), shared with other clients. Thousands of connections
+  // can thus share a handful of I/O threads. The service must outlive the
+  // client, and it is not stopped by the client.
+  explicit Client(const std::string& host, const std::string& port,
+                  core::Service& service)
+      : host_(host),
+        port_(port),
+        service_(service),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client connects to the given endpoints, already resolved, instead of
+  // resolving a host: the connections never wait for the DNS. The endpoints
+  // are tried in order, and must not be empty.
+  explicit Client(const network::Resolver::endpoints& endpoints)
+      : host_(endpoints.front().address().to_string()),
+        port_(std::to_string(endpoints.front().port())),
+        endpoints_(endpoints),
+        owned_service_(new core::Service),
+        service_(*owned_service_),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client connects to the given endpoints, already resolved, and runs on
+  // an externally owned service.
+  explicit Client(const network::Resolver::endpoints& endpoints,
+                  core::Service& service)
+      : host_(endpoints.front().address().to_string()),
+        port_(std::to_string(endpoints.front().port())),
+        endpoints_(endpoints),
+        service_(service),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Copy Ctor
+  Client(const Client&) = delete;
+  // Assignment operator
+  Client& operator=(const Client&) = delete;
+
+  // Dtor
+  ~Client() noexcept {
+    disconnect();
+    // the pending handlers of the reconnection become no-ops.
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    reconnection_->client = nullptr;
+  }
+
+  // performs a synchronous connection
+  // the endpoints of the host are tried with staggered attempts, the first
+  // one accepting the connection wins (cf: Stream::async_connect). The name
+  // resolution is cached (cf: network::Resolver).
+  void connect() {
+    auto called = false;
+
+    try {
+      if (is_connected()) throw core::Error::User("Client Already connected.");
+      if (not admitted()) return;
+
+      auto start = std::chrono::steady_clock::now();
+      called = true;
+      session_->service().run();
+      session_->connect(resolve());
+      if (breaker_) breaker_->success(std::chrono::steady_clock::now() - start);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+      if (called and breaker_) breaker_->failure();
+    }
+  }
+
+  // performs an asynchronous connection
+  //
+  //  @param:
+  //    - callback
+  //
+  //  A callback could be provided and it will be invoked when the asynchronous
+  //  connection will be completed.
+  //  async_connect does not wait for the name resolution nor for the
+  //  connection: the client is connected once the callback is invoked.
+  //  A failure of the connection is reported to the error handler.
+  void async_connect(
+      const std::function<void(network::Stream&)>& callback = nullptr) {
+    try {
+      if (is_connected()) throw core::Error::User("Client Already connected.");
+      if (not admitted()) return;
+
+      auto session = session_;
+      auto breaker = breaker_;
+      auto reconnection = reconnection_;
+      auto start = std::chrono::steady_clock::now();
+
+      service_.run();
+      async_resolve([session, breaker, reconnection, start, callback](
+          const asio::error_code& error,
+          const network::Resolver::endpoints& endpoints) {
+        if (error) {
+          if (breaker) breaker->failure();
+          core::Error::print(error.message());
+          return;
+        }
+
+        // the resolver runs on its own thread: the connection is started
+        // from the strand of the client, unless the client is destroyed
+        // (with its service) meanwhile.
+        std::lock_guard<std::mutex> lock(reconnection->mutex);
+        auto client = reconnection->client;
+
+        if (not client) return;
+        client->service_.get_strand().post([session, breaker, reconnection,
+                                            start, callback, endpoints]() {
+          std::lock_guard<std::mutex> lock(reconnection->mutex);
+          if (not reconnection->client) return;
+          if (not breaker) return session->async_connect(endpoints, callback);
+
+          session->async_connect(endpoints, [session, breaker, reconnection,
+                                             start, callback](
+                                                const asio::error_code& error) {
+            record(breaker, error, start);
+            if (error)
+              report(reconnection, error, *session);
+            else if (callback)
+              callback(*session);
+          });
+        });
+      });
     } catch (std::exception& e) {
       core::Error::print(e.what());
     }
   }
 
+  // enables the reconnecting mode.
+  //
+  //  @param:
+  //    - capacity, the maximum number of messages buffered while disconnected.
+  //    - backoff, the delays between the reconnection attempts.
+  //
+  //  When a send fails, or when sending while the client is not connected,
+  //  the client reconnects in background instead of giving up, retrying with
+  //  the given backoff. Meanwhile, the messages passed to send and async_send
+  //  are buffered and then replayed in order once reconnected. The messages
+  //  beyond the capacity are dropped.
+  //  A failed message is buffered entirely, the server may thus receive it
+  //  twice if it was partially written.
+  //  disconnect() leaves the reconnecting mode and drops the buffer.
+  void enable_reconnect(std::size_t capacity = 1024,
+                        const core::Backoff& backoff = core::Backoff()) {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    reconnection_->enabled = true;
+    reconnection_->capacity = capacity;
+    reconnection_->backoff = backoff;
+  }
+
+  // returns the number of messages waiting for the reconnection.
+  std::size_t buffered() {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    return reconnection_->buffered.size();
+  }
+
   // disconnect the client by stopping the service and closing the session
+  // a shared service is not stopped.
   void disconnect() {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      core::Error error;
+
+      reconnection_->enabled = false;
+      reconnection_->pending = false;
+      reconnection_->buffered.clear();
+      timer_.cancel(error.get());
+    }
+
     if (is_connected()) {
       session_->disconnect();
-      service_.stop();
+      if (owned_service_) service_.stop();
     }
   }
 
+  // asynchronous and graceful disconnection.
+  // the pending asynchronous sends are flushed, then the connection is
+  // half-closed and closed. The callback is invoked once it is done.
+  // Unlike disconnect, the service is not stopped, so it can be called from
+  // a handler.
+  void async_disconnect(
+      const std::function<void(network::Stream&)>& callback = nullptr) {
+    session_->async_disconnect(callback);
+  }
+
   // synchronous sending of data
   std::size_t send(const std::string& message) {
     std::size_t bytes = 0;
+    auto called = false;
 
     try {
-      if (not is_connected())
+      if (not is_connected()) {
+        if (defer(message)) return bytes;
         throw core::Error::User("Client is not connected.");
+      }
+      if (not admitted()) return bytes;
+
+      auto start = std::chrono::steady_clock::now();
+      called = true;
       bytes = session_->send(message);
+      if (breaker_) breaker_->success(std::chrono::steady_clock::now() - start);
     } catch (std::exception& e) {
       core::Error::print(e.what());
-      disconnect();
+      if (called and breaker_) breaker_->failure();
+      if (not defer(message)) disconnect();
     }
     return bytes;
   }
@@ -622,25 +2663,65 @@ class Client {
   // asynchronous sending of data
   void async_send(const std::string& message) {
     try {
-      if (not is_connected())
+      if (not is_connected()) {
+        if (defer(message)) return;
         throw core::Error::User("Client is not connected.");
-      session_->async_send(message);
+      }
+      if (not admitted()) return;
+      if (reconnecting())
+        track(message);
+      else if (breaker_)
+        observe(message);
+      else
+        session_->async_send(message);
     } catch (std::exception& e) {
       core::Error::print(e.what());
       disconnect();
     }
   }
 
+  // asynchronous send of data returning a future.
+  // the future is completed from the I/O thread with the number of bytes
+  // sent, or holds the error of the operation. Many sends can be issued and
+  // then waited on in bulk.
+  std::future<std::size_t> send_async(const std::string& message) {
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    auto breaker = breaker_;
+    auto start = std::chrono::steady_clock::now();
+
+    if (not is_connected())
+      promise->set_exception(std::make_exception_ptr(
+          core::Error::User("Client is not connected.")));
+    else if (breaker and not breaker->allow())
+      promise->set_exception(std::make_exception_ptr(core::Error::Connection(
+          "Circuit breaker open for " + host_ + ":" + port_ + ".")));
+    else
+      session_->async_send(message, [promise, breaker, start](
+                                        const asio::error_code& error,
+                                        std::size_t bytes) {
+        record(breaker, error, start);
+        core::complete(*promise, error, bytes);
+      });
+    return promise->get_future();
+  }
+
   // synchronous receive
   std::string receive() {
     std::string received("");
+    auto called = false;
 
     try {
       if (not is_connected())
         throw core::Error::User("Client is not connected.");
+      if (not admitted()) return received;
+
+      called = true;
       received = session_->receive();
+      // waiting for the data is not a latency of the server.
+      if (breaker_) breaker_->success();
     } catch (std::exception& e) {
       core::Error::print(e.what());
+      if (called and breaker_) breaker_->failure();
       disconnect();
     }
     return received;
@@ -658,10 +2739,31 @@ class Client {
     }
   }
 
+  // asynchronous receive returning a future.
+  // the future is completed from the I/O thread with the data received, or
+  // holds the error of the operation.
+  std::future<std::string> receive_async() {
+    auto promise = std::make_shared<std::promise<std::string>>();
+
+    if (not is_connected())
+      promise->set_exception(std::make_exception_ptr(
+          core::Error::User("Client is not connected.")));
+    else
+      session_->async_receive([promise](const asio::error_code& error,
+                                        std::string received) {
+        core::complete(*promise, error, received);
+      });
+    return promise->get_future();
+  }
+
   // set the handler which will be invoked when the asynchronous send operation
   //  will be performed.
   void set_send_handler(
       const std::function<void(std::size_t, network::Stream&)>& callback) {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      reconnection_->send_handler = callback;
+    }
     session_->set_write_handler(callback);
   }
 
@@ -673,154 +2775,3269 @@ class Client {
     session_->set_read_handler(callback);
   }
 
+#ifdef HERMES_COROUTINES
+  // co_await-able connection.
+  auto co_connect() {
+    if (is_connected()) throw core::Error::User("Client Already connected.");
+    session_->service().run();
+    return session_->co_connect(resolve().front());
+  }
+
+  // co_await-able send, returns the number of bytes sent.
+  auto co_send(const std::string& message) {
+    if (not is_connected()) throw core::Error::User("Client is not connected.");
+    return session_->co_send(message);
+  }
+
+  // co_await-able receive, returns the data received.
+  auto co_receive() {
+    if (not is_connected()) throw core::Error::User("Client is not connected.");
+    return session_->co_receive();
+  }
+#endif  // HERMES_COROUTINES
+
+  // set the handler which will be invoked when an asynchronous operation
+  // fails.
+  void set_error_handler(
+      const std::function<void(const asio::error_code&, network::Stream&)>&
+          callback) {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      reconnection_->error_handler = callback;
+    }
+    session_->set_error_handler(callback);
+  }
+
+  // sets the circuit breaker guarding the calls to the server, nullptr to
+  // disable it (default). Use core::CircuitBreaker::of(host + ":" + port) to
+  // share the breaker of the server with its other clients.
+  // While the breaker is open, connect, send and receive fail immediately,
+  // as well as async_connect, async_send and send_async. The outcome of the
+  // asynchronous calls is recorded once they complete.
+  // NOTE: must be set before the client is used.
+  void set_circuit_breaker(
+      const std::shared_ptr<core::CircuitBreaker>& breaker) {
+    breaker_ = breaker;
+  }
+
+  // enables TCP Fast Open on the next connections, cf:
+  // network::Stream::set_fast_open.
+  void set_fast_open(bool enable) { session_->set_fast_open(enable); }
+
+  // starts a batch of asynchronous sends, written together by flush, cf:
+  // network::Stream::begin_batch.
+  void begin_batch() { session_->begin_batch(); }
+
+  // writes the batch of asynchronous sends.
+  void flush() { session_->flush(); }
+
+  // sets the options of the connection, cf: network::SocketOptions.
+  void set_options(const network::SocketOptions& options) {
+    session_->set_options(options);
+  }
+
+  // sets the cache of the responses to the requests, nullptr to disable it
+  // (default). A cache can be shared by the clients of a same server.
+  // NOTE: must be set before the client is used.
+  void set_cache(const std::shared_ptr<core::Cache>& cache) { cache_ = cache; }
+
+  // synchronous request: sends the payload and returns the data received in
+  // response. The data is received until the predicate says the response is
+  // complete (e.g: ends_with("\n")), a response may indeed be split across
+  // several reads. With a cache, an answered request identified by the same
+  // key is served from the cache, without reaching the network. A response
+  // interrupted by an error is returned as is, but never cached.
+  // Only use it for idempotent requests.
+  std::string request(const std::string& key, const std::string& payload,
+                      const predicate& complete) {
+    std::string response("");
+
+    if (cache_ and cache_->get(key, response)) return response;
+    if (not send(payload)) return response;
+    while (not complete(response)) {
+      auto received = receive();
+
+      if (received.empty()) return response;
+      response += received;
+    }
+    if (cache_) cache_->put(key, response);
+    return response;
+  }
+
+  // synchronous request identified by its payload.
+  std::string request(const std::string& payload, const predicate& complete) {
+    return request(payload, payload, complete);
+  }
+
+  // returns a predicate saying that a response is complete once it ends with
+  // the delimiter, for the line-based protocols.
+  static predicate ends_with(const std::string& delimiter) {
+    return [delimiter](const std::string& response) {
+      return response.size() >= delimiter.size() and
+             response.compare(response.size() - delimiter.size(),
+                              delimiter.size(), delimiter) == 0;
+    };
+  }
+
   // returns true whether the client is connected, false otherwise.
   bool is_connected() { return session_->is_connected(); }
 
+  // returns true whether the connection is still usable: the server has not
+  // closed it and no error is pending on the socket.
+  bool is_alive() { return session_->is_alive(); }
+
  private:
-  // the host to wich the client is connected.
-  std::string host_;
-  // the port used to connect to the given host.
-  std::string port_;
-  // I/O services.
-  core::Service service_;
-  // The connection to the host.
-  network::Stream::session session_;
-};
+  // State of the reconnecting mode, shared with the handlers of the
+  // reconnection which can outlive the client.
+  struct Reconnection {
+    explicit Reconnection(Client* owner)
+        : client(owner), enabled(false), pending(false), capacity(0) {}
 
-/**
-*   @brief: TCP server
-*
-*   @param:
-*     - port to listen on (string)
-*
-*   @link:
-*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md*
-*/
-class Server {
- public:
+    // Protects the state and the client from its handlers.
+    std::mutex mutex;
+    // The client, nullptr once destroyed.
+    Client* client;
+    // Indicates if the reconnecting mode is enabled.
+    bool enabled;
+    // Indicates if a reconnection is scheduled or in progress.
+    bool pending;
+    // The maximum number of messages buffered.
+    std::size_t capacity;
+    // The messages waiting for the reconnection.
+    std::deque<std::string> buffered;
+    // The delays between the attempts.
+    core::Backoff backoff;
+    // The send handler, invoked for the tracked sends.
+    std::function<void(std::size_t, network::Stream&)> send_handler;
+    // The error handler, invoked for the observed calls.
+    std::function<void(const asio::error_code&, network::Stream&)>
+        error_handler;
+  };
+
+  // returns false if the circuit breaker refuses the call, which is then
+  // failed immediately. Once allowed, the outcome of the call must be
+  // recorded, as it can be the probe of a half-open breaker.
+  bool admitted() {
+    if (not breaker_ or breaker_->allow()) return true;
+    core::Error::print("Circuit breaker open for " + host_ + ":" + port_ + ".");
+    return false;
+  }
+
+  // records the outcome of an asynchronous call started at start.
+  static void record(const std::shared_ptr<core::CircuitBreaker>& breaker,
+                     const asio::error_code& error,
+                     const std::chrono::steady_clock::time_point& start) {
+    if (not breaker) return;
+    if (error)
+      breaker->failure();
+    else
+      breaker->success(std::chrono::steady_clock::now() - start);
+  }
+
+  // reports the error of an observed call to the error handler, as the
+  // stream would have done.
+  static void report(const std::shared_ptr<Reconnection>& reconnection,
+                     const asio::error_code& error, network::Stream& session) {
+    std::unique_lock<std::mutex> lock(reconnection->mutex);
+    auto handler = reconnection->error_handler;
+
+    // the handler is invoked unlocked, it can use the client.
+    lock.unlock();
+    if (handler)
+      handler(error, session);
+    else
+      core::Error::print(error.message());
+  }
+
+  // sends the message, its outcome is recorded by the circuit breaker and
+  // then reported to the send or error handler.
+  void observe(const std::string& message) {
+    auto session = session_;
+    auto breaker = breaker_;
+    auto reconnection = reconnection_;
+    auto start = std::chrono::steady_clock::now();
+
+    session_->async_send(message, [session, breaker, reconnection, start](
+                                      const asio::error_code& error,
+                                      std::size_t bytes) {
+      record(breaker, error, start);
+      if (error) {
+        // a message dropped by a close is not an error of the server.
+        if (error != asio::error::operation_aborted)
+          report(reconnection, error, *session);
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(reconnection->mutex);
+      auto handler = reconnection->send_handler;
+      lock.unlock();
+      if (handler) handler(bytes, *session);
+    });
+  }
+
+  // returns true whether the reconnecting mode is enabled.
+  bool reconnecting() {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    return reconnection_->enabled;
+  }
+
+  // buffers the message and schedules a reconnection.
+  // returns false if the reconnecting mode is disabled.
+  bool defer(const std::string& message) {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+
+    if (not reconnection_->enabled) return false;
+    buffer(message);
+    schedule();
+    return true;
+  }
+
+  // buffers the message to be replayed once reconnected, drops it if the
+  // buffer is full. reconnection_->mutex must be locked.
+  void buffer(const std::string& message) {
+    if (reconnection_->buffered.size() < reconnection_->capacity)
+      reconnection_->buffered.push_back(message);
+    else
+      core::Error::print("Reconnecting, buffer full. Message dropped.");
+  }
+
+  // schedules a reconnection attempt after the next backoff delay, unless one
+  // is pending. reconnection_->mutex must be locked.
+  void schedule() {
+    if (reconnection_->pending) return;
+
+    auto reconnection = reconnection_;
+
+    reconnection_->pending = true;
+    service_.run();
+    timer_.expires_after(reconnection_->backoff.next());
+    timer_.async_wait(service_.get_strand().wrap(
+        [reconnection](const asio::error_code& error) {
+          std::lock_guard<std::mutex> lock(reconnection->mutex);
+          if (error or not reconnection->client or not reconnection->enabled)
+            return;
+          reconnection->client->reconnect();
+        }));
+  }
+
+  // closes the broken connection, resolves the host again (its address may
+  // have changed across a restart, once the cache entry expired) and
+  // connects. Runs in the strand, reconnection_->mutex locked.
+  void reconnect() {
+    auto reconnection = reconnection_;
+
+    session_->disconnect();
+    async_resolve([reconnection](
+        const asio::error_code& error,
+        const network::Resolver::endpoints& endpoints) {
+      std::lock_guard<std::mutex> lock(reconnection->mutex);
+      auto client = reconnection->client;
+
+      if (not client or not reconnection->enabled) return;
+      client->service_.get_strand().post([reconnection, error, endpoints]() {
+        std::lock_guard<std::mutex> lock(reconnection->mutex);
+        auto client = reconnection->client;
+
+        if (not client or not reconnection->enabled) return;
+        if (error) return client->retry();
+
+        client->session_->async_connect(
+            endpoints, [reconnection](const asio::error_code& error) {
+              std::lock_guard<std::mutex> lock(reconnection->mutex);
+              auto client = reconnection->client;
+
+              if (not client or not reconnection->enabled) return;
+              if (error)
+                client->retry();
+              else
+                client->replay();
+            });
+      });
+    });
+  }
+
+  // returns the endpoints given at construction, or resolves host:port with
+  // the shared resolver, waiting only on a cache miss.
+  network::Resolver::endpoints resolve() {
+    if (not endpoints_.empty()) return endpoints_;
+    return network::Resolver::shared().resolve(host_, port_);
+  }
+
+  // asynchronous version of resolve, the callback is never invoked from the
+  // calling thread.
+  void async_resolve(const network::Resolver::callback& callback) {
+    if (endpoints_.empty())
+      return network::Resolver::shared().async_resolve(host_, port_, callback);
+
+    auto endpoints = endpoints_;
+    service_.run();
+    service_.post([callback, endpoints]() {
+      callback(asio::error_code(), endpoints);
+    });
+  }
+
+  // schedules the next attempt. reconnection_->mutex must be locked.
+  void retry() {
+    reconnection_->pending = false;
+    schedule();
+  }
+
+  // sends the buffered messages, in order, once reconnected.
+  // reconnection_->mutex must be locked.
+  void replay() {
+    std::deque<std::string> buffered;
+
+    buffered.swap(reconnection_->buffered);
+    reconnection_->pending = false;
+    reconnection_->backoff.reset();
+    for (const auto& message : buffered) track(message);
+  }
+
+  // asynchronous send of data, buffered again on failure to be replayed after
+  // the reconnection.
+  void track(const std::string& message) {
+    auto reconnection = reconnection_;
+    auto breaker = breaker_;
+    auto start = std::chrono::steady_clock::now();
+
+    session_->async_send(message, [reconnection, breaker, start, message](
+                                      const asio::error_code& error,
+                                      std::size_t bytes) {
+      record(breaker, error, start);
+      std::unique_lock<std::mutex> lock(reconnection->mutex);
+      auto client = reconnection->client;
+
+      if (not client or not reconnection->enabled) return;
+      if (error) {
+        client->buffer(message);
+        client->schedule();
+        return;
+      }
+
+      // the handler is invoked unlocked, it can send again.
+      auto handler = reconnection->send_handler;
+      auto session = client->session_;
+      lock.unlock();
+      if (handler) handler(bytes, *session);
+    });
+  }
+
+  // the host to wich the client is connected.
+  std::string host_;
+  // the port used to connect to the given host.
+  std::string port_;
+  // The endpoints of the host, if given at construction.
+  network::Resolver::endpoints endpoints_;
+  // The service owned by the client, if not shared.
+  std::unique_ptr<core::Service> owned_service_;
+  // I/O services.
+  core::Service& service_;
+  // The connection to the host.
+  network::Stream::session session_;
+  // The reconnecting mode.
+  std::shared_ptr<Reconnection> reconnection_;
+  // Delays the reconnection attempts.
+  asio::steady_timer timer_;
+  // The circuit breaker of the server, if any.
+  std::shared_ptr<core::CircuitBreaker> breaker_;
+  // The cache of the responses, if any.
+  std::shared_ptr<core::Cache> cache_;
+};
+
+/**
+*   @brief: Pool of TCP clients
+*
+*   @description: ClientPool keeps, for each host:port, a set of connected
+*   clients handed out to the callers, so that the connection latency is
+*   removed from the request path. A caller checks out a client, which is
+*   returned to the pool once the Lease is destroyed.
+*   For each host:port, the pool opens at most max connections and keeps at
+*   least min of them warm. A maintenance thread health-checks the idle
+*   clients and replaces the broken ones.
+*   The clients of the pool share the services of a core::ServicePool.
+*
+*   @param:
+*     - min (size_t) warm connections kept per host:port.
+*     - max (size_t) maximum number of connections per host:port.
+*     - threads (size_t) I/O threads shared by the clients.
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class ClientPool {
+  struct Bucket;
+
+ public:
+  /**
+  *   @brief: a client checked out from the pool.
+  *
+  *   @description: gives an exclusive access to the client. The client goes
+  *   back to the pool when the lease is destroyed, or is discarded if it is
+  *   not connected anymore.
+  */
+  class Lease {
+   public:
+    Lease(Lease&& other) noexcept
+        : pool_(other.pool_),
+          bucket_(other.bucket_),
+          client_(std::move(other.client_)) {
+      other.pool_ = nullptr;
+    }
+
+    Lease& operator=(Lease&& other) noexcept {
+      if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        bucket_ = other.bucket_;
+        client_ = std::move(other.client_);
+        other.pool_ = nullptr;
+      }
+      return *this;
+    }
+
+    // Copy Ctor
+    Lease(const Lease&) = delete;
+    // Assignment operator
+    Lease& operator=(const Lease&) = delete;
+
+    // Dtor
+    ~Lease() noexcept { release(); }
+
+    Client& operator*() { return *client_; }
+    Client* operator->() { return client_.get(); }
+
+    // returns the client to the pool.
+    void release() {
+      if (pool_ and client_) pool_->give_back(*bucket_, std::move(client_));
+      pool_ = nullptr;
+    }
+
+    // destroys the client instead of returning it to the pool, e.g: after a
+    // protocol error leaving the connection in an unknown state.
+    void discard() {
+      if (pool_ and client_) {
+        client_.reset();
+        pool_->give_back(*bucket_, nullptr);
+      }
+      pool_ = nullptr;
+    }
+
+   private:
+    friend class ClientPool;
+
+    Lease(ClientPool* pool, Bucket* bucket, std::unique_ptr<Client> client)
+        : pool_(pool), bucket_(bucket), client_(std::move(client)) {}
+
+    // The pool to which the client is returned.
+    ClientPool* pool_;
+    // The host:port of the client.
+    Bucket* bucket_;
+    // The client.
+    std::unique_ptr<Client> client_;
+  };
+
+  // Ctor
+  explicit ClientPool(std::size_t min = 1, std::size_t max = 8,
+                      std::size_t threads = 1)
+      : min_(min),
+        max_(std::max<std::size_t>(max, 1)),
+        stopped_(false),
+        interval_(std::chrono::seconds(5)),
+        services_(threads) {
+    maintenance_ = std::thread([this]() { maintain(); });
+  }
+
+  // Copy Ctor
+  ClientPool(const ClientPool&) = delete;
+  // Assignment operator
+  ClientPool& operator=(const ClientPool&) = delete;
+
+  // Dtor
+  // NOTE: the leases must be released before the pool is destroyed.
+  ~ClientPool() noexcept {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    condvar_.notify_all();
+    wakeup_.notify_all();
+    if (maintenance_.joinable()) maintenance_.join();
+    buckets_.clear();
+  }
+
+  // checks out a connected client to host:port.
+  // An idle client is handed out if there is one, otherwise a new connection
+  // is opened as long as max is not reached. Once it is reached, waits for a
+  // client to be returned until the timeout expires.
+  //
+  // throws core::Error::Connection if no client could be handed out.
+  Lease checkout(
+      const std::string& host, const std::string& port,
+      const std::chrono::milliseconds& timeout = std::chrono::seconds(5)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto& bucket = get_bucket(host, port);
+
+    for (;;) {
+      while (not bucket.idle.empty()) {
+        auto client = std::move(bucket.idle.front());
+        bucket.idle.pop_front();
+        if (client->is_alive())
+          return Lease(this, &bucket, std::move(client));
+        --bucket.total;
+      }
+
+      if (bucket.total < max_) {
+        ++bucket.total;
+        lock.unlock();
+        auto client = open(bucket);
+        lock.lock();
+        if (client) return Lease(this, &bucket, std::move(client));
+        --bucket.total;
+        condvar_.notify_all();
+        throw core::Error::Connection("Cannot connect to " + host + ":" +
+                                      port + ".");
+      }
+
+      if (condvar_.wait_until(lock, deadline) == std::cv_status::timeout and
+          bucket.idle.empty())
+        throw core::Error::Connection("No client available for " + host +
+                                      ":" + port + ".");
+    }
+  }
+
+  // opens min connections to host:port ahead of the first checkout.
+  void warm_up(const std::string& host, const std::string& port) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    refill(get_bucket(host, port), lock);
+  }
+
+  // sets the period of the health-check of the idle clients.
+  void set_check_interval(const std::chrono::milliseconds& interval) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      interval_ = interval;
+    }
+    wakeup_.notify_all();
+  }
+
+  // returns the number of idle clients to host:port.
+  std::size_t idle(const std::string& host, const std::string& port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_bucket(host, port).idle.size();
+  }
+
+  // returns the number of clients (idle and checked out) to host:port.
+  std::size_t size(const std::string& host, const std::string& port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_bucket(host, port).total;
+  }
+
+ private:
+  // The clients to a host:port.
+  struct Bucket {
+    std::string host;
+    std::string port;
+    std::deque<std::unique_ptr<Client>> idle;
+    std::size_t total;
+  };
+
+  // returns the bucket of host:port. mutex_ must be locked.
+  Bucket& get_bucket(const std::string& host, const std::string& port) {
+    auto& bucket = buckets_[host + ":" + port];
+
+    if (bucket.host.empty()) {
+      bucket.host = host;
+      bucket.port = port;
+      bucket.total = 0;
+    }
+    return bucket;
+  }
+
+  // opens a new connection, returns nullptr on failure.
+  std::unique_ptr<Client> open(const Bucket& bucket) {
+    std::unique_ptr<Client> client(
+        new Client(bucket.host, bucket.port, services_.next()));
+
+    client->connect();
+    if (not client->is_connected()) client.reset();
+    return client;
+  }
+
+  // takes back a client, nullptr for a discarded one.
+  void give_back(Bucket& bucket, std::unique_ptr<Client> client) {
+    std::unique_ptr<Client> broken;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (client and client->is_connected() and not stopped_) {
+        bucket.idle.push_back(std::move(client));
+      } else {
+        broken = std::move(client);
+        --bucket.total;
+      }
+    }
+    condvar_.notify_all();
+  }
+
+  // opens connections until the bucket holds min clients.
+  // mutex_ must be locked, it is released while connecting.
+  void refill(Bucket& bucket, std::unique_lock<std::mutex>& lock) {
+    while (not stopped_ and bucket.total < std::min(min_, max_)) {
+      ++bucket.total;
+      lock.unlock();
+      auto client = open(bucket);
+      lock.lock();
+
+      if (not client) {
+        --bucket.total;
+        return;
+      }
+      bucket.idle.push_back(std::move(client));
+      condvar_.notify_all();
+    }
+  }
+
+  // health-checks the idle clients, replaces the broken ones and keeps min
+  // clients warm, every interval.
+  void maintain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (not stopped_) {
+      wakeup_.wait_for(lock, interval_);
+      if (stopped_) break;
+
+      // the lock is released while iterating, a checkout may insert into
+      // buckets_ and invalidate its iterators. The buckets themselves are
+      // never erased and their addresses are stable.
+      std::vector<Bucket*> snapshot;
+      for (auto& it : buckets_) snapshot.push_back(&it.second);
+
+      for (auto* it : snapshot) {
+        auto& bucket = *it;
+        std::vector<std::unique_ptr<Client>> broken;
+
+        for (auto client = bucket.idle.begin(); client != bucket.idle.end();) {
+          if ((*client)->is_alive()) {
+            ++client;
+          } else {
+            broken.push_back(std::move(*client));
+            client = bucket.idle.erase(client);
+            --bucket.total;
+          }
+        }
+
+        lock.unlock();
+        broken.clear();
+        lock.lock();
+        refill(bucket, lock);
+      }
+    }
+  }
+
+  // warm connections kept per host:port.
+  std::size_t min_;
+  // maximum number of connections per host:port.
+  std::size_t max_;
+  // Indicates if the pool is being destroyed.
+  bool stopped_;
+  // period of the health-check.
+  std::chrono::milliseconds interval_;
+  // I/O services shared by the clients.
+  core::ServicePool services_;
+  // Protects the buckets.
+  std::mutex mutex_;
+  // Notified when a client is returned.
+  std::condition_variable condvar_;
+  // Wakes up the health-check thread.
+  std::condition_variable wakeup_;
+  // The clients, by host:port.
+  std::unordered_map<std::string, Bucket> buckets_;
+  // Health-check thread.
+  std::thread maintenance_;
+};
+
+/**
+*   @brief: Multiplexed request/response over one TCP connection
+*
+*   @description: Multiplexer allows many requests to be in flight at the same
+*   time on a single connection. Each request is sent in a frame carrying an
+*   id, and the server answers with a frame carrying the same id. The
+*   responses can thus arrive in any order, each one completes the future or
+*   the callback of its request.
+*
+*   A frame is made of a header followed by the payload:
+*     - the size of the payload (4 bytes, network byte order).
+*     - the id of the request (8 bytes, network byte order).
+*
+*   The server side is provided by Multiplexer::serve.
+*   A frame larger than MAX_PAYLOAD_SIZE is never buffered: the connection
+*   is closed and its pending requests fail with message_size.
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class Multiplexer {
+ public:
+  // The size of the header of a frame.
+  static std::size_t const HEADER_SIZE = 12;
+
+  // The maximum size of the payload of a frame (64MB).
+  static std::size_t const MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+  // invoked with the response of a request, or with the error which
+  // prevented it (e.g: operation_aborted once cancelled).
+  typedef std::function<void(const asio::error_code&, std::string)> callback;
+
+  // invoked by serve with a request and the function sending its response.
+  // respond can be called later, from any thread: the responses do not have
+  // to follow the order of the requests.
+  typedef std::function<void(std::string,
+                             std::function<void(const std::string&)>)>
+      handler;
+
+  // Ctor
+  // the multiplexer owns its service.
+  explicit Multiplexer(const std::string& host, const std::string& port)
+      : host_(host),
+        port_(port),
+        owned_service_(new core::Service),
+        service_(*owned_service_),
+        session_(network::Stream::new_session(service_)),
+        state_(std::make_shared<State>()),
+        next_id_(0) {}
+
+  // Ctor
+  // the multiplexer runs on an externally owned service.
+  explicit Multiplexer(const std::string& host, const std::string& port,
+                       core::Service& service)
+      : host_(host),
+        port_(port),
+        service_(service),
+        session_(network::Stream::new_session(service_)),
+        state_(std::make_shared<State>()),
+        next_id_(0) {}
+
+  // Copy Ctor
+  Multiplexer(const Multiplexer&) = delete;
+  // Assignment operator
+  Multiplexer& operator=(const Multiplexer&) = delete;
+
+  // Dtor
+  ~Multiplexer() noexcept {
+    {
+      // a connection in progress is dropped.
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      state_->destroyed = true;
+    }
+    disconnect();
+  }
+
+  // performs a synchronous connection and starts reading the responses.
+  void connect() {
+    try {
+      if (is_connected())
+        throw core::Error::User("Multiplexer Already connected.");
+      // closes the connection lost, if any.
+      session_->disconnect();
+      session_->service().run();
+      session_->connect(network::Resolver::shared().resolve(host_, port_));
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->closed = false;
+        state_->inbox.clear();
+      }
+      read(session_, state_);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+    }
+  }
+
+  // asynchronous connection, the completion is invoked from the I/O thread
+  // with the result once the responses are read. Never blocks the caller:
+  // the connection lost, if any, is closed from the strand, then the host is
+  // resolved and connected asynchronously. The completion is dropped if the
+  // multiplexer is destroyed meanwhile.
+  void async_connect(
+      const std::function<void(const asio::error_code&)>& completion) {
+    auto session = session_;
+    auto state = state_;
+    auto host = host_;
+    auto port = port_;
+
+    service_.run();
+    if (is_connected()) {
+      service_.post(
+          [completion]() { completion(asio::error::already_connected); });
+      return;
+    }
+
+    service_.get_strand().post([session, state, host, port, completion]() {
+      // from the strand, the socket is closed without waiting.
+      session->disconnect();
+      network::Resolver::shared().async_resolve(
+          host, port, [session, state, completion](
+                          const asio::error_code& error,
+                          const network::Resolver::endpoints& endpoints) {
+            // runs on the resolver thread, the service of the session is
+            // only used while the multiplexer is alive.
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->destroyed) return;
+
+            if (error) {
+              session->service().get_strand().post(
+                  [completion, error]() { completion(error); });
+              return;
+            }
+            session->async_connect(endpoints, [session, state, completion](
+                                                  const asio::error_code& error) {
+              if (not error) {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                if (state->destroyed) {
+                  lock.unlock();
+                  session->disconnect();
+                  return;
+                }
+                state->closed = false;
+                state->inbox.clear();
+                lock.unlock();
+                read(session, state);
+              }
+              completion(error);
+            });
+          });
+    });
+  }
+
+  // closes the connection, the pending requests fail with operation_aborted.
+  // a shared service is not stopped.
+  void disconnect() {
+    if (session_->is_connected()) {
+      session_->disconnect();
+      if (owned_service_) service_.stop();
+    }
+    fail(state_, asio::error::operation_aborted);
+  }
+
+  // sends a request, the callback is invoked from the I/O thread with the
+  // response. Returns the id of the request, to be cancelled.
+  // If the multiplexer is not connected, the callback is invoked immediately
+  // with not_connected, or with message_size if the payload is larger than
+  // MAX_PAYLOAD_SIZE.
+  std::uint64_t request(const std::string& payload, const callback& callback) {
+    auto id = next_id_++;
+    auto state = state_;
+
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+      callback(asio::error::message_size, "");
+      return id;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      if (state_->closed) {
+        lock.unlock();
+        callback(asio::error::not_connected, "");
+        return id;
+      }
+      state_->pending[id] = callback;
+    }
+    session_->async_send(frame(id, payload), [state, id](
+                                                 const asio::error_code& error,
+                                                 std::size_t) {
+      if (error) complete(state, id, error, "");
+    });
+    return id;
+  }
+
+  // sends a request, the future is completed with the response, or holds the
+  // error of the request.
+  std::future<std::string> request(const std::string& payload) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+
+    request(payload, [promise](const asio::error_code& error,
+                               std::string response) {
+      core::complete(*promise, error, response);
+    });
+    return promise->get_future();
+  }
+
+  // cancels a pending request, its callback is invoked with
+  // operation_aborted and its response, if any, is dropped.
+  // returns false if the request is not pending anymore.
+  bool cancel(std::uint64_t id) {
+    return complete(state_, id, asio::error::operation_aborted, "");
+  }
+
+  // returns the number of requests waiting for their response.
+  std::size_t in_flight() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->pending.size();
+  }
+
+  // returns true whether the multiplexer is connected, false otherwise (e.g:
+  // once the connection has been lost).
+  bool is_connected() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return session_->is_connected() and not state_->closed;
+  }
+
+  // serves the requests received on the session: the handler is invoked for
+  // each request, and its response is sent back with the id of the request.
+  // serve returns immediately, the requests are read until the connection is
+  // closed.
+  //
+  // @code: c++
+  //  server.set_accept_handler([](hermes::network::Stream::session session) {
+  //    hermes::tcp::Multiplexer::serve(session, [](std::string request,
+  //                                     std::function<void(const std::string&)> respond) {
+  //      respond("response to " + request);
+  //    });
+  //  });
+  // @endcode
+  static void serve(network::Stream::session session, const handler& handler) {
+    serve(session, handler, std::make_shared<std::string>());
+  }
+
+ private:
+  // The requests waiting for their response, shared with the handlers of
+  // the connection.
+  struct State {
+    State() : closed(true), destroyed(false) {}
+
+    std::mutex mutex;
+    std::unordered_map<std::uint64_t, callback> pending;
+    // Indicates if the connection is closed, the requests are then refused.
+    bool closed;
+    // Indicates if the multiplexer is destroyed, with its service if owned.
+    bool destroyed;
+    // The data received, not yet parsed.
+    std::string inbox;
+  };
+
+  // builds the frame of a payload.
+  static std::string frame(std::uint64_t id, const std::string& payload) {
+    if (static_cast<std::uint64_t>(payload.size()) > 0xffffffffULL)
+      throw core::Error::User("Payload too large to be framed.");
+
+    std::string frame;
+
+    frame.reserve(HEADER_SIZE + payload.size());
+    core::put_integer(frame, static_cast<std::uint32_t>(payload.size()));
+    core::put_integer(frame, id);
+    frame += payload;
+    return frame;
+  }
+
+  // extracts the first complete frame of the buffer.
+  // returns false if the buffer does not hold a complete frame yet.
+  static bool unframe(std::string& buffer, std::uint64_t& id,
+                      std::string& payload) {
+    if (buffer.size() < HEADER_SIZE) return false;
+
+    auto size = core::get_integer<std::uint32_t>(buffer, 0);
+    if (buffer.size() < HEADER_SIZE + size) return false;
+
+    id = core::get_integer<std::uint64_t>(buffer, 4);
+    payload = buffer.substr(HEADER_SIZE, size);
+    buffer.erase(0, HEADER_SIZE + size);
+    return true;
+  }
+
+  // returns true whether the next frame of the buffer announces a payload
+  // larger than MAX_PAYLOAD_SIZE.
+  static bool oversized(const std::string& buffer) {
+    return buffer.size() >= HEADER_SIZE and
+           core::get_integer<std::uint32_t>(buffer, 0) > MAX_PAYLOAD_SIZE;
+  }
+
+  // serves the requests of the session, the inbox holds the data received
+  // not yet parsed.
+  static void serve(network::Stream::session session, const handler& handler,
+                    const std::shared_ptr<std::string>& inbox) {
+    session->async_receive([session, handler, inbox](
+                               const asio::error_code& error,
+                               std::string received) {
+      if (error) return;
+
+      std::uint64_t id;
+      std::string payload;
+
+      *inbox += received;
+      while (unframe(*inbox, id, payload)) {
+        auto weak = std::weak_ptr<network::Stream>(session);
+        handler(payload, [weak, id](const std::string& response) {
+          auto session = weak.lock();
+          if (not session) return;
+
+          // the client would never accept it.
+          if (response.size() > MAX_PAYLOAD_SIZE) {
+            core::Error::print("Response too large, connection closed.");
+            session->disconnect();
+            return;
+          }
+          session->async_send(frame(id, response),
+                              [](const asio::error_code&, std::size_t) {});
+        });
+      }
+
+      if (oversized(*inbox)) {
+        core::Error::print("Request too large, connection closed.");
+        session->disconnect();
+        return;
+      }
+      serve(session, handler, inbox);
+    });
+  }
+
+  // reads the responses continuously and completes their requests.
+  // Runs in the strand of the session.
+  static void read(network::Stream::session session,
+                   std::shared_ptr<State> state) {
+    session->async_receive(
+        [session, state](const asio::error_code& error, std::string received) {
+          if (error) {
+            fail(state, error);
+            return;
+          }
+
+          std::uint64_t id;
+          std::string response;
+
+          state->inbox += received;
+          while (unframe(state->inbox, id, response))
+            complete(state, id, asio::error_code(), response);
+
+          if (oversized(state->inbox)) {
+            session->disconnect();
+            fail(state, asio::error::message_size);
+            return;
+          }
+          read(session, state);
+        });
+  }
+
+  // completes the request, if still pending.
+  static bool complete(const std::shared_ptr<State>& state, std::uint64_t id,
+                       const asio::error_code& error,
+                       const std::string& response) {
+    callback callback;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      auto it = state->pending.find(id);
+      if (it == state->pending.end()) return false;
+      callback = std::move(it->second);
+      state->pending.erase(it);
+    }
+    callback(error, response);
+    return true;
+  }
+
+  // fails all the pending requests.
+  static void fail(const std::shared_ptr<State>& state,
+                   const asio::error_code& error) {
+    std::unordered_map<std::uint64_t, callback> pending;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->closed = true;
+      pending.swap(state->pending);
+    }
+    for (auto& request : pending) request.second(error, "");
+  }
+
+  // the host to wich the multiplexer is connected.
+  std::string host_;
+  // the port used to connect to the given host.
+  std::string port_;
+  // The service owned by the multiplexer, if not shared.
+  std::unique_ptr<core::Service> owned_service_;
+  // I/O services.
+  core::Service& service_;
+  // The connection to the host.
+  network::Stream::session session_;
+  // The pending requests.
+  std::shared_ptr<State> state_;
+  // The id of the next request.
+  std::atomic<std::uint64_t> next_id_;
+};
+
+/**
+*   @brief: Client-side load balancing across a set of servers
+*
+*   @description: BalancedClient holds a multiplexed connection to each
+*   server of a set, and picks one per request with the power of two choices:
+*   two servers are drawn randomly and the less loaded one is chosen. The load
+*   is either the number of requests in flight, or the latency (an
+*   exponentially weighted moving average) weighted by the requests in
+*   flight, which routes around the slow servers.
+*   A server failing several requests in a row is ejected for a while, then
+*   tried again: it is reconnected in background and skipped until it is
+*   connected. If all the servers are ejected, all of them are used.
+*   The requests can be hedged: a request without response after a
+*   percentile of the latency is sent to a second server, and the first
+*   response wins.
+*
+*   The servers answer with Multiplexer::serve.
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class BalancedClient {
+ public:
+  // The load of a server.
+  enum Policy { IN_FLIGHT, LATENCY };
+
+  // Ctor
+  //
+  //  @param:
+  //    - servers, the host:port of the servers.
+  //    - policy, the load used to pick a server.
+  //    - threads, the I/O threads shared by the connections.
+  explicit BalancedClient(
+      const std::vector<std::pair<std::string, std::string>>& servers,
+      Policy policy = IN_FLIGHT, std::size_t threads = 1)
+      : policy_(policy),
+        failures_(3),
+        ejection_(std::chrono::seconds(5)),
+        percentile_(0.95),
+        budget_(0),
+        hedge_tokens_(0),
+        hedged_(0),
+        samples_(0),
+        computed_(0),
+        delay_(0),
+        random_(std::random_device{}()),
+        services_(threads) {
+    if (servers.empty())
+      throw core::Error::User("BalancedClient needs at least one server.");
+
+    for (const auto& server : servers)
+      backends_.emplace_back(std::make_shared<Backend>(
+          server.first, server.second, services_.next()));
+  }
+
+  // Copy Ctor
+  BalancedClient(const BalancedClient&) = delete;
+  // Assignment operator
+  BalancedClient& operator=(const BalancedClient&) = delete;
+
+  // Dtor
+  ~BalancedClient() noexcept { disconnect(); }
+
+  // connects to the servers, the ones which cannot be reached are ejected.
+  void connect() {
+    for (auto& backend : backends_) {
+      backend->multiplexer.connect();
+      if (backend->multiplexer.is_connected()) continue;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      eject(*backend);
+    }
+  }
+
+  // closes the connections, the pending requests fail with
+  // operation_aborted.
+  void disconnect() {
+    for (auto& backend : backends_) backend->multiplexer.disconnect();
+  }
+
+  // sends a request to the server picked, the callback is invoked from the
+  // I/O thread with the response, or with the error of the request.
+  // If the hedging is enabled, the request can be sent to a second server,
+  // cf: set_hedging.
+  void request(const std::string& payload,
+               const Multiplexer::callback& callback) {
+    auto delay = hedging_delay();
+
+    if (delay == std::chrono::microseconds::zero()) {
+      send(pick(), payload, callback);
+      return;
+    }
+
+    auto hedge = std::make_shared<Hedge>(services_.next().get(), callback);
+    auto& backend = pick();
+
+    hedge->backends[0] = &backend;
+    attempt(hedge, 0, payload);
+
+    // no response within the delay, the request is sent to another server.
+    hedge->timer.expires_after(delay);
+    hedge->timer.async_wait([this, hedge, payload](const asio::error_code& error) {
+      if (error) return;
+
+      auto& other = pick(hedge->backends[0]);
+      if (&other == hedge->backends[0]) return;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hedge_tokens_ < 1) return;
+        hedge_tokens_ -= 1;
+        ++hedged_;
+      }
+      {
+        std::lock_guard<std::mutex> lock(hedge->mutex);
+        if (hedge->done) return;
+        hedge->backends[1] = &other;
+      }
+      attempt(hedge, 1, payload);
+    });
+  }
+
+  // sends a request to the server picked, the future is completed with the
+  // response, or holds the error of the request.
+  std::future<std::string> request(const std::string& payload) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+
+    request(payload, [promise](const asio::error_code& error,
+                               std::string response) {
+      core::complete(*promise, error, response);
+    });
+    return promise->get_future();
+  }
+
+  // sets the number of failures in a row ejecting a server, and the duration
+  // of the ejection.
+  void set_ejection(std::size_t failures,
+                    const std::chrono::milliseconds& duration) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failures_ = std::max<std::size_t>(failures, 1);
+    ejection_ = duration;
+  }
+
+  // returns the number of servers which are not ejected.
+  std::size_t healthy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    return std::count_if(backends_.begin(), backends_.end(),
+                         [&now](const std::shared_ptr<Backend>& backend) {
+                           return backend->ejected_until <= now;
+                         });
+  }
+
+  // enables the hedged requests, to cut the tail latency.
+  //
+  //  @param:
+  //    - percentile, of the latency of the requests, after which a request
+  //      without response is sent to a second server. The first response
+  //      wins, the other request is cancelled.
+  //    - budget, the maximum ratio of requests hedged, which caps the extra
+  //      load put on the servers.
+  //
+  //  The hedging starts once enough latencies have been observed.
+  void set_hedging(double percentile = 0.95, double budget = 0.05) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    percentile_ = std::min(std::max(percentile, 0.0), 1.0);
+    budget_ = std::max(budget, 0.0);
+    // the delay is computed again with the new percentile.
+    delay_ = std::chrono::microseconds::zero();
+  }
+
+  // returns the number of requests hedged.
+  std::size_t hedged() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hedged_;
+  }
+
+  // returns the number of requests in flight on the given server.
+  std::size_t in_flight(std::size_t server) {
+    return backends_.at(server)->in_flight;
+  }
+
+ private:
+  // A server and its statistics.
+  struct Backend {
+    Backend(const std::string& host, const std::string& port,
+            core::Service& service)
+        : multiplexer(host, port, service),
+          in_flight(0),
+          latency(0),
+          failures(0),
+          connection(std::make_shared<std::atomic<int>>(IDLE)) {}
+
+    // The connection to the server.
+    Multiplexer multiplexer;
+    // Number of requests waiting for their response.
+    std::atomic<std::size_t> in_flight;
+    // Moving average of the latency, in microseconds.
+    double latency;
+    // Number of requests failed in a row.
+    std::size_t failures;
+    // The server is not picked until then.
+    std::chrono::steady_clock::time_point ejected_until;
+    // The state of the background reconnection, shared with its completion.
+    std::shared_ptr<std::atomic<int>> connection;
+  };
+
+  // The states of the background reconnection of a server.
+  enum { IDLE, CONNECTING, FAILED };
+
+  // A request sent to up to two servers.
+  struct Hedge {
+    Hedge(asio::io_context& io_context, const Multiplexer::callback& callback)
+        : done(false), failed(false), callback(callback), timer(io_context) {
+      backends[0] = backends[1] = nullptr;
+      ids[0] = ids[1] = 0;
+      sent[0] = sent[1] = cancelled[0] = cancelled[1] = false;
+    }
+
+    // Protects the state of the request.
+    std::mutex mutex;
+    // Indicates if the request is completed.
+    bool done;
+    // Indicates if an attempt failed, the other one is waited for.
+    bool failed;
+    // The servers of the attempts.
+    Backend* backends[2];
+    // The ids of the attempts, once sent.
+    std::uint64_t ids[2];
+    bool sent[2];
+    // Indicates if the attempt must be cancelled once sent.
+    bool cancelled[2];
+    // The callback of the request.
+    Multiplexer::callback callback;
+    // Starts the second attempt.
+    asio::steady_timer timer;
+  };
+
+  // sends a request to the server and updates its statistics.
+  // returns the id of the request.
+  std::uint64_t send(Backend& backend, const std::string& payload,
+                     const Multiplexer::callback& callback) {
+    auto start = std::chrono::steady_clock::now();
+
+    ++backend.in_flight;
+    return backend.multiplexer.request(
+        payload, [this, &backend, start, callback](
+                     const asio::error_code& error, std::string response) {
+          --backend.in_flight;
+          completed(backend, error, std::chrono::steady_clock::now() - start);
+          callback(error, response);
+        });
+  }
+
+  // sends an attempt of a hedged request.
+  void attempt(const std::shared_ptr<Hedge>& hedge, std::size_t index,
+               const std::string& payload) {
+    auto id = send(*hedge->backends[index], payload,
+                   [this, hedge, index](const asio::error_code& error,
+                                        std::string response) {
+                     finish(hedge, index, error, response);
+                   });
+
+    bool cancel;
+    {
+      std::lock_guard<std::mutex> lock(hedge->mutex);
+      hedge->ids[index] = id;
+      hedge->sent[index] = true;
+      cancel = hedge->cancelled[index];
+    }
+    // the other attempt won before this one was sent.
+    if (cancel) hedge->backends[index]->multiplexer.cancel(id);
+  }
+
+  // completes a hedged request with the first response, and cancels the
+  // other attempt. An error only completes the request if the other attempt
+  // is not in flight.
+  void finish(const std::shared_ptr<Hedge>& hedge, std::size_t index,
+              const asio::error_code& error, const std::string& response) {
+    auto other = 1 - index;
+    bool cancel = false;
+    {
+      std::lock_guard<std::mutex> lock(hedge->mutex);
+      if (hedge->done) return;
+
+      if (error and hedge->backends[other] and not hedge->failed) {
+        hedge->failed = true;
+        return;
+      }
+
+      core::Error ignored;
+      hedge->done = true;
+      hedge->timer.cancel(ignored.get());
+      if (hedge->backends[other]) {
+        cancel = hedge->sent[other];
+        hedge->cancelled[other] = true;
+      }
+    }
+
+    if (cancel) hedge->backends[other]->multiplexer.cancel(hedge->ids[other]);
+    hedge->callback(error, response);
+  }
+
+  // returns the delay after which a request is hedged, zero if the hedging
+  // is disabled or if not enough latencies have been observed. A token of
+  // the budget is earned per request.
+  // The percentile is computed again every REFRESH_SAMPLES latencies only,
+  // rather than per request.
+  std::chrono::microseconds hedging_delay() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (budget_ == 0 or latencies_.size() < MIN_SAMPLES)
+      return std::chrono::microseconds::zero();
+
+    hedge_tokens_ = std::min(hedge_tokens_ + budget_, double(MAX_TOKENS));
+    if (delay_ == std::chrono::microseconds::zero() or
+        samples_ - computed_ >= REFRESH_SAMPLES) {
+      auto latencies = latencies_;
+      auto nth = latencies.begin() +
+                 static_cast<std::size_t>(percentile_ * (latencies.size() - 1));
+
+      std::nth_element(latencies.begin(), nth, latencies.end());
+      delay_ = std::chrono::microseconds(
+          std::max<std::int64_t>(static_cast<std::int64_t>(*nth), 1));
+      computed_ = samples_;
+    }
+    return delay_;
+  }
+
+  // picks a server with the power of two choices, other than the excluded
+  // one unless it is the only server available. The servers disconnected
+  // whose ejection ended are reconnected in background, and skipped
+  // meanwhile: the caller neither connects nor waits for a connection, so
+  // pick can run on an I/O thread.
+  Backend& pick(const Backend* excluded = nullptr) {
+    std::vector<std::shared_ptr<Backend>> eligible;
+    std::vector<Backend*> candidates;
+    auto now = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& backend : backends_)
+        if (backend->ejected_until <= now) eligible.push_back(backend);
+    }
+
+    // the multiplexers are used without mutex_, which their handlers lock.
+    for (auto& backend : eligible) {
+      if (backend->multiplexer.is_connected())
+        candidates.push_back(backend.get());
+      else
+        reconnect(*backend);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // all the servers are ejected, all of them are used.
+    if (candidates.empty())
+      for (auto& backend : backends_) candidates.push_back(backend.get());
+    if (excluded and candidates.size() > 1)
+      candidates.erase(
+          std::remove(candidates.begin(), candidates.end(), excluded),
+          candidates.end());
+    if (candidates.size() == 1) return *candidates.front();
+
+    std::uniform_int_distribution<std::size_t> draw(0, candidates.size() - 1);
+    auto first = draw(random_);
+    auto second = draw(random_);
+    while (second == first) second = draw(random_);
+
+    auto a = candidates[first];
+    auto b = candidates[second];
+    return load(*a) <= load(*b) ? *a : *b;
+  }
+
+  // starts the background reconnection of the server, unless one is in
+  // progress. A server which could not be reconnected is ejected again.
+  // mutex_ must not be locked.
+  void reconnect(Backend& backend) {
+    auto connection = backend.connection;
+    int failed = FAILED;
+    int idle = IDLE;
+
+    if (connection->compare_exchange_strong(failed, IDLE)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      eject(backend);
+      return;
+    }
+    if (not connection->compare_exchange_strong(idle, CONNECTING)) return;
+
+    // the completion only keeps the state of the reconnection alive: the
+    // last reference on the server, and its multiplexer, must not be
+    // released from an I/O thread.
+    backend.multiplexer.async_connect(
+        [connection](const asio::error_code& error) {
+          *connection = error ? FAILED : IDLE;
+        });
+  }
+
+  // returns the load of a server according to the policy.
+  // mutex_ must be locked.
+  double load(const Backend& backend) {
+    if (policy_ == IN_FLIGHT) return static_cast<double>(backend.in_flight);
+    return backend.latency * (backend.in_flight + 1);
+  }
+
+  // updates the statistics of the server with the result of a request.
+  void completed(Backend& backend, const asio::error_code& error,
+                 const std::chrono::steady_clock::duration& elapsed) {
+    // a cancelled request says nothing about the server.
+    if (error == asio::error::operation_aborted) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error) {
+      if (++backend.failures >= failures_) eject(backend);
+      return;
+    }
+
+    auto sample = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    backend.failures = 0;
+    backend.latency = backend.latency == 0
+                          ? sample
+                          : ALPHA * sample + (1 - ALPHA) * backend.latency;
+
+    // the latencies of the last requests, to compute the hedging delay.
+    if (latencies_.size() < MAX_SAMPLES)
+      latencies_.push_back(sample);
+    else
+      latencies_[samples_ % MAX_SAMPLES] = sample;
+    ++samples_;
+  }
+
+  // ejects the server. mutex_ must be locked.
+  void eject(Backend& backend) {
+    backend.failures = 0;
+    backend.ejected_until = std::chrono::steady_clock::now() + ejection_;
+  }
+
+  // The weight of the last sample in the moving average of the latency.
+  static constexpr double ALPHA = 0.3;
+  // Number of latencies observed before hedging.
+  static std::size_t const MIN_SAMPLES = 20;
+  // Number of latencies kept to compute the hedging delay.
+  static std::size_t const MAX_SAMPLES = 1000;
+  // Number of latencies observed before the hedging delay is computed again.
+  static std::size_t const REFRESH_SAMPLES = 100;
+  // The unused budget is capped, to absorb a burst of hedges only.
+  static constexpr double MAX_TOKENS = 10;
+
+  // The load used to pick a server.
+  Policy policy_;
+  // Number of failures in a row ejecting a server.
+  std::size_t failures_;
+  // Duration of an ejection.
+  std::chrono::milliseconds ejection_;
+  // Percentile of the latency after which a request is hedged.
+  double percentile_;
+  // Maximum ratio of requests hedged, 0 if the hedging is disabled.
+  double budget_;
+  // Hedges allowed by the budget.
+  double hedge_tokens_;
+  // Number of requests hedged.
+  std::size_t hedged_;
+  // The latencies of the last requests, in microseconds.
+  std::vector<double> latencies_;
+  // Number of latencies observed.
+  std::size_t samples_;
+  // Number of latencies observed when the delay was computed.
+  std::size_t computed_;
+  // The hedging delay.
+  std::chrono::microseconds delay_;
+  // Protects the statistics of the servers.
+  std::mutex mutex_;
+  // Draws the servers.
+  std::mt19937 random_;
+  // I/O services shared by the connections.
+  core::ServicePool services_;
+  // The servers.
+  std::vector<std::shared_ptr<Backend>> backends_;
+};
+
+/**
+*   @brief: Coalescing of identical requests (singleflight)
+*
+*   @description: Coalescer sits on top of a multiplexed client (Multiplexer
+*   or BalancedClient). While a request is in flight, the identical requests
+*   (same key, by default the payload) are not sent: their callers are
+*   attached to the request in flight and receive its response, or its error.
+*   Only use it for requests whose response does not depend on the caller.
+*
+*   @code: c++
+*    hermes::tcp::Multiplexer multiplexer("127.0.0.1", "8080");
+*    hermes::tcp::Coalescer<hermes::tcp::Multiplexer> coalescer(multiplexer);
+*
+*    multiplexer.connect();
+*    std::future<std::string> response = coalescer.request("get user 42");
+*  @endcode
+*
+*/
+template <typename Client>
+class Coalescer {
+ public:
+  // Ctor
+  // the client must outlive the coalescer. The coalescer can be destroyed
+  // with requests in flight, their callers still receive the response.
+  explicit Coalescer(Client& client)
+      : client_(client), state_(std::make_shared<State>()) {}
+
+  // Copy Ctor
+  Coalescer(const Coalescer&) = delete;
+  // Assignment operator
+  Coalescer& operator=(const Coalescer&) = delete;
+
+  // sends the request, unless an identical one is in flight. The identical
+  // requests are identified by the given key.
+  void request(const std::string& key, const std::string& payload,
+               const Multiplexer::callback& callback) {
+    auto state = state_;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      auto& waiting = state->in_flight[key];
+
+      waiting.push_back(callback);
+      if (waiting.size() > 1) {
+        ++state->coalesced;
+        return;
+      }
+    }
+
+    // the callback holds the state, not the coalescer which can be gone.
+    client_.request(payload, [state, key](const asio::error_code& error,
+                                          std::string response) {
+      std::vector<Multiplexer::callback> waiting;
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto it = state->in_flight.find(key);
+        waiting.swap(it->second);
+        state->in_flight.erase(it);
+      }
+      for (auto& callback : waiting) callback(error, response);
+    });
+  }
+
+  // sends the request, unless an identical one is in flight. The identical
+  // requests are identified by their payload.
+  void request(const std::string& payload,
+               const Multiplexer::callback& callback) {
+    request(payload, payload, callback);
+  }
+
+  // future-returning version, the requests are identified by the given key.
+  std::future<std::string> request(const std::string& key,
+                                   const std::string& payload) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+
+    request(key, payload, [promise](const asio::error_code& error,
+                                    std::string response) {
+      core::complete(*promise, error, response);
+    });
+    return promise->get_future();
+  }
+
+  // future-returning version, the requests are identified by their payload.
+  std::future<std::string> request(const std::string& payload) {
+    return request(payload, payload);
+  }
+
+  // returns the number of requests which have not been sent, attached to an
+  // identical request in flight.
+  std::size_t coalesced() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->coalesced;
+  }
+
+ private:
+  // The requests in flight, shared with the callbacks of the client which
+  // can outlive the coalescer.
+  struct State {
+    State() : coalesced(0) {}
+
+    // Protects the requests in flight.
+    std::mutex mutex;
+    // The callers of the requests in flight, by key.
+    std::unordered_map<std::string, std::vector<Multiplexer::callback>>
+        in_flight;
+    // Number of requests coalesced.
+    std::size_t coalesced;
+  };
+
+  // The multiplexed client.
+  Client& client_;
+  // The requests in flight.
+  std::shared_ptr<State> state_;
+};
+
+/**
+*   @brief: Client sharding the keys across a set of servers
+*
+*   @description: ShardedClient maps each key to a server with consistent
+*   hashing, and keeps a client connected to each server. Each server is
+*   placed at many points (virtual nodes) of a ring of hashes, and a key goes
+*   to the server of the first point following its hash. The keys are thus
+*   spread evenly, and adding or removing a server only remaps the keys of
+*   this server (about 1/n of them).
+*   The hash (FNV-1a) does not depend on the platform: the processes sharing
+*   the same set of servers map the keys the same way.
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class ShardedClient {
+ public:
+  // Ctor
+  //
+  //  @param:
+  //    - servers, the host:port of the servers.
+  //    - replicas, the number of virtual nodes of each server.
+  //    - threads, the I/O threads shared by the connections.
+  explicit ShardedClient(
+      const std::vector<std::pair<std::string, std::string>>& servers = {},
+      std::size_t replicas = 160, std::size_t threads = 1)
+      : replicas_(std::max<std::size_t>(replicas, 1)), services_(threads) {
+    for (const auto& server : servers) add(server.first, server.second);
+  }
+
+  // Copy Ctor
+  ShardedClient(const ShardedClient&) = delete;
+  // Assignment operator
+  ShardedClient& operator=(const ShardedClient&) = delete;
+
+  // adds a server, it is connected on its first use.
+  void add(const std::string& host, const std::string& port) {
+    auto name = host + ":" + port;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (clients_.count(name)) return;
+    clients_[name] = std::make_shared<Shard>(host, port, services_.next());
+    for (std::size_t i = 0; i < replicas_; ++i)
+      ring_[hash(name + "#" + std::to_string(i))] = name;
+  }
+
+  // removes a server, its keys go to the other servers. The client of the
+  // server is disconnected once no longer used.
+  void remove(const std::string& host, const std::string& port) {
+    auto name = host + ":" + port;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (not clients_.erase(name)) return;
+    for (auto it = ring_.begin(); it != ring_.end();)
+      it = it->second == name ? ring_.erase(it) : std::next(it);
+  }
+
+  // returns the host:port of the server of the key.
+  std::string server(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return locate(key);
+  }
+
+  // returns the client of the server of the key, connected if possible
+  // (cf: Client::connect).
+  // NOTE: the client must not be used once the ShardedClient is destroyed.
+  std::shared_ptr<Client> get(const std::string& key) {
+    std::shared_ptr<Shard> shard;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shard = clients_[locate(key)];
+    }
+    if (shard->client->is_connected()) return shard->client;
+
+    // serializes the connection of a client used by many threads, the other
+    // clients are connected meanwhile.
+    std::lock_guard<std::mutex> lock(shard->connecting);
+    if (not shard->client->is_connected()) shard->client->connect();
+    return shard->client;
+  }
+
+  // returns the number of servers.
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_.size();
+  }
+
+  // 64-bit FNV-1a hash.
+  static std::uint64_t hash(const std::string& data) {
+    std::uint64_t hash = 14695981039346656037ULL;
+
+    for (unsigned char c : data) {
+      hash ^= c;
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+ private:
+  // The client of a server.
+  struct Shard {
+    Shard(const std::string& host, const std::string& port,
+          core::Service& service)
+        : client(std::make_shared<Client>(host, port, service)) {}
+
+    // The client, shared with the callers.
+    std::shared_ptr<Client> client;
+    // Held while the client is connected.
+    std::mutex connecting;
+  };
+
+  // the server of the first point following the hash of the key.
+  const std::string& locate(const std::string& key) {
+    if (ring_.empty()) throw core::Error::User("ShardedClient has no server.");
+
+    auto it = ring_.lower_bound(hash(key));
+    return it == ring_.end() ? ring_.begin()->second : it->second;
+  }
+
+  // Number of virtual nodes of each server.
+  std::size_t replicas_;
+  // Protects the ring and the clients.
+  std::mutex mutex_;
+  // I/O services shared by the clients, they outlive the clients.
+  core::ServicePool services_;
+  // The points of the servers, by hash.
+  std::map<std::uint64_t, std::string> ring_;
+  // The clients, by host:port.
+  std::map<std::string, std::shared_ptr<Shard>> clients_;
+};
+
+/**
+*   @brief: Replicated writes acknowledged by a quorum of servers
+*
+*   @description: Replicator holds a multiplexed connection to each replica
+*   and sends a request to all of them concurrently. The request succeeds
+*   once a quorum of replicas acknowledged it (i.e: answered), and fails as
+*   soon as the quorum cannot be reached anymore, or after the timeout. The
+*   replicas which have not answered yet are then cancelled, their responses
+*   are ignored.
+*   The payload is serialized once by the caller and shared by the replicas.
+*
+*   The replicas answer with Multiplexer::serve.
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class Replicator {
+ public:
+  // The callback of a request, invoked with the acknowledgements received.
+  typedef std::function<void(const asio::error_code&,
+                             std::vector<std::string>)>
+      callback;
+
+  // Ctor
+  //
+  //  @param:
+  //    - replicas, the host:port of the replicas.
+  //    - quorum, the number of acknowledgements needed, at most the number
+  //      of replicas.
+  //    - timeout, after which a request without quorum fails with timed_out.
+  //    - threads, the I/O threads shared by the connections.
+  explicit Replicator(
+      const std::vector<std::pair<std::string, std::string>>& replicas,
+      std::size_t quorum,
+      const std::chrono::milliseconds& timeout = std::chrono::seconds(1),
+      std::size_t threads = 1)
+      : quorum_(std::min(std::max<std::size_t>(quorum, 1), replicas.size())),
+        timeout_(timeout),
+        services_(threads) {
+    for (const auto& replica : replicas)
+      replicas_.emplace_back(
+          new Multiplexer(replica.first, replica.second, services_.next()));
+  }
+
+  // Copy Ctor
+  Replicator(const Replicator&) = delete;
+  // Assignment operator
+  Replicator& operator=(const Replicator&) = delete;
+
+  // Dtor
+  ~Replicator() noexcept { disconnect(); }
+
+  // connects to the replicas, the ones which cannot be reached fail the
+  // requests until connected.
+  void connect() {
+    for (auto& replica : replicas_) replica->connect();
+  }
+
+  // closes the connections, the pending requests fail with
+  // operation_aborted.
+  void disconnect() {
+    for (auto& replica : replicas_) replica->disconnect();
+  }
+
+  // sends the request to all the replicas, the callback is invoked from the
+  // I/O thread once the quorum is reached, or with the error which prevents
+  // it (with the acknowledgements received so far).
+  void send(const std::string& payload, const callback& callback) {
+    auto write = std::make_shared<Write>(services_.next().get(),
+                                         replicas_.size(), callback);
+
+    write->timer.expires_after(timeout_);
+    write->timer.async_wait([this, write](const asio::error_code& error) {
+      std::unique_lock<std::mutex> lock(write->mutex);
+      if (not error and not write->done)
+        finish(write, lock, asio::error::timed_out);
+    });
+
+    for (std::size_t i = 0; i < replicas_.size(); ++i) {
+      auto id = replicas_[i]->request(
+          payload, [this, write, i](const asio::error_code& error,
+                                    std::string response) {
+            acknowledge(write, i, error, response);
+          });
+
+      std::unique_lock<std::mutex> lock(write->mutex);
+      write->ids[i] = id;
+      write->sent[i] = true;
+      // completed meanwhile, the request is a straggler.
+      if (write->done and not write->answered[i]) {
+        lock.unlock();
+        replicas_[i]->cancel(id);
+      }
+    }
+  }
+
+  // sends the request to all the replicas, the future is completed with the
+  // acknowledgements of the quorum, or holds the error which prevents it.
+  std::future<std::vector<std::string>> send(const std::string& payload) {
+    auto promise = std::make_shared<std::promise<std::vector<std::string>>>();
+
+    send(payload, [promise](const asio::error_code& error,
+                            std::vector<std::string> acks) {
+      core::complete(*promise, error, std::move(acks));
+    });
+    return promise->get_future();
+  }
+
+  // returns the number of acknowledgements needed.
+  std::size_t quorum() const { return quorum_; }
+
+ private:
+  // A request sent to the replicas.
+  struct Write {
+    Write(asio::io_context& io_context, std::size_t replicas,
+          const Replicator::callback& callback)
+        : failures(0),
+          done(false),
+          ids(replicas, 0),
+          sent(replicas, false),
+          answered(replicas, false),
+          callback(callback),
+          io_context(io_context),
+          timer(io_context) {}
+
+    // Protects the state of the request.
+    std::mutex mutex;
+    // The acknowledgements received.
+    std::vector<std::string> acks;
+    // Number of replicas which failed.
+    std::size_t failures;
+    // Indicates if the request is completed.
+    bool done;
+    // The id of the request on each replica.
+    std::vector<std::uint64_t> ids;
+    // Indicates if the request has been sent to the replica.
+    std::vector<bool> sent;
+    // Indicates if the replica answered.
+    std::vector<bool> answered;
+    // The callback of the caller.
+    Replicator::callback callback;
+    // Runs the callback of the caller.
+    asio::io_context& io_context;
+    // Fails the request after the timeout.
+    asio::steady_timer timer;
+  };
+
+  // records the answer of a replica.
+  void acknowledge(const std::shared_ptr<Write>& write, std::size_t replica,
+                   const asio::error_code& error, const std::string& response) {
+    std::unique_lock<std::mutex> lock(write->mutex);
+    if (write->done) return;
+
+    write->answered[replica] = true;
+    if (error) {
+      if (++write->failures > replicas_.size() - quorum_)
+        finish(write, lock, error);
+      return;
+    }
+    write->acks.push_back(response);
+    if (write->acks.size() == quorum_) finish(write, lock, asio::error_code());
+  }
+
+  // completes the request and cancels the stragglers. The callback is posted
+  // to the I/O thread: a replica failing inline (e.g: not connected) must not
+  // complete the request from send().
+  void finish(const std::shared_ptr<Write>& write,
+              std::unique_lock<std::mutex>& lock,
+              const asio::error_code& error) {
+    std::vector<std::pair<std::size_t, std::uint64_t>> stragglers;
+    core::Error ignored;
+
+    write->done = true;
+    write->timer.cancel(ignored.get());
+    for (std::size_t i = 0; i < replicas_.size(); ++i)
+      if (write->sent[i] and not write->answered[i])
+        stragglers.emplace_back(i, write->ids[i]);
+    auto acks = std::move(write->acks);
+    lock.unlock();
+
+    for (const auto& straggler : stragglers)
+      replicas_[straggler.first]->cancel(straggler.second);
+    write->io_context.post(
+        [write, error, acks]() { write->callback(error, acks); });
+  }
+
+  // Number of acknowledgements needed.
+  std::size_t quorum_;
+  // Timeout of the requests.
+  std::chrono::milliseconds timeout_;
+  // I/O services shared by the connections.
+  core::ServicePool services_;
+  // The connections to the replicas.
+  std::vector<std::unique_ptr<Multiplexer>> replicas_;
+};
+
+/**
+*   @brief: TCP server
+*
+*   @param:
+*     - port to listen on (string)
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md*
+*/
+class Server {
+ public:
+  // Ctor
+  explicit Server(const std::string& port)
+      : port_(port),
+        strand_(service_.get()),
+        acceptor_(service_.get()),
+        session_(network::Stream::new_session(service_)),
+        accept_handler_(nullptr) {
+    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), std::stoi(port_));
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+  }
+
+  // Copy Ctor
+  Server(const Server&) = delete;
+  // Assignment operator
+  Server& operator=(const Server&) = delete;
+
+  // Dtor
+  ~Server() noexcept { stop(); }
+
+  // run the server
+  //
+  // @param:
+  //    - bool async
+  //
+  // If you run the server with 'false' as parameter, you will run an iterative
+  // server, it means that you could handle only one connection at a time.
+  // Otherwise, run the server with 'true' to be able to handle many connections
+  // asynchronously.
+  //
+  // NOTE: you have to set the accept handler before calling the 'run' method.
+  //       this handler represents the behavior of your server when it accepts
+  //       a new connection.
+  //
+  void run(bool async) {
+    try {
+      if (not acceptor_.is_open())
+        throw core::Error::Connection(
+            "Unexpected error occured."
+            " Cannot open asio::ip::tcp::acceptor. Operation aborted.");
+
+      if (not async) {
+        core::Error error;
+
+        session_->service().run();
+        acceptor_.accept(session_->socket(), error.get());
+        if (error.exist()) error.throw_it();
+        session_->set_options(options_);
+        if (accept_handler_) accept_handler_(std::move(session_));
+        session_.reset();
+        session_ = network::Stream::new_session(service_);
+        return;
+
+      } else {
+        // in the case where the run method is called with true as parameter
+        // we post through the server strand object a handler which contains
+        // the async accept. This handler is posted through the strand object to
+        // ensure that there will be at least one connection accepted.
+        strand_.post(std::bind(&Server::handler, this));
+      }
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+    }
+  }
+
+  // stops the server
+  void stop() {
+    session_->disconnect();
+    service_.stop();
+  }
+
+#ifdef HERMES_COROUTINES
+  // co_await-able accept, returns the session of the new connection.
+  //
+  // @code: c++
+  //  for (;;) {
+  //    auto connection = co_await server.co_accept();
+  //    // do some stuff.
+  //  }
+  // @endcode
+  auto co_accept() {
+    service_.run();
+    auto session = network::Stream::new_session(service_);
+
+    return core::make_awaitable<network::Stream::session>(
+        [this, session](auto done) {
+          acceptor_.async_accept(
+              session->socket(),
+              service_.get_strand().wrap(
+                  [this, session, done](const asio::error_code& error) {
+                    if (not error) session->set_options(options_);
+                    done(error, session);
+                  }));
+        });
+  }
+#endif  // HERMES_COROUTINES
+
+  // set the accept handler.
+  // this handler represents the server's behavior when it accepts a new
+  // connection.
+  void set_accept_handler(
+      const std::function<void(network::Stream::session)>& callback) {
+    accept_handler_ = callback;
+  }
+
+  // sets the options of the sessions accepted afterwards, cf:
+  // network::SocketOptions. The buffer sizes are also set on the listening
+  // socket, so that the window of the handshake uses them.
+  // NOTE: must be set before running the server.
+  void set_options(const network::SocketOptions& options) {
+    core::Error ignored;
+
+    options_ = options;
+    if (options.send_buffer)
+      acceptor_.set_option(
+          asio::socket_base::send_buffer_size(options.send_buffer),
+          ignored.get());
+    if (options.receive_buffer)
+      acceptor_.set_option(
+          asio::socket_base::receive_buffer_size(options.receive_buffer),
+          ignored.get());
+  }
+
+  // enables TCP Fast Open: the data sent with the SYN of the clients using it
+  // are accepted, without waiting for the end of the handshake. The queue is
+  // the maximum number of such connections not accepted yet.
+  // Where TCP_FASTOPEN is not supported, the error is printed and the
+  // connections use the regular handshake.
+  void set_fast_open(int queue = 256) {
+    core::Error error;
+
+#ifdef TCP_FASTOPEN
+    acceptor_.set_option(network::tcp_option<TCP_FASTOPEN>(queue), error.get());
+#else
+    error.get() = asio::error::operation_not_supported;
+#endif
+    if (error.exist()) core::Error::print(error.get().message());
+  }
+
+ private:
+  // Performs the async accept.
+  // once the socket is accepted and the connection made, the session_ is moved to
+  // the accept handler. As this is a shared_ptr, the connection will remain
+  // until there is operation on it. Then we reset the session_ and call again
+  // the handler method to accept a new connection.
+  void handler() {
+    acceptor_.async_accept(
+        session_->socket(), session_->service().get_strand().wrap([this](
+                                const asio::error_code& error) {
+
+          if (error) throw asio::system_error(error);
+          session_->set_options(options_);
+
+          // This part is scope locked and a mutex is used to
+          // ensure the thread safety and avoid concurrencies issues of the
+          // accept handler.
+          std::mutex mutex;
+          std::lock_guard<std::mutex> lock(mutex);
+          {
+            if (accept_handler_) accept_handler_(std::move(session_));
+            session_.reset();
+            session_ = network::Stream::new_session(service_);
+          }
+          // we call the function itself to accept a new connection.
+          handler();
+        }));
+  }
+
+  // The port to which the server is listenning on.
+  std::string port_;
+  // I/O services.
+  core::Service service_;
+  // Dedicated strand object for the server.
+  asio::io_context::strand strand_;
+  // The options of the sessions accepted.
+  network::SocketOptions options_;
+  // Acceptor, the Asio facilitator to accept socket and enable tcp connection.
+  asio::ip::tcp::acceptor acceptor_;
+  // A connection to a client
+  network::Stream::session session_;
+  // The handler invoked when the asynchronous accept is performed.
+  std::function<void(network::Stream::session)> accept_handler_;
+};
+
+}  // namespace tcp
+
+/**
+*  @brief: The udp namespace is the UDP counterpart of the tcp namespace. It is
+*  the top level of users' interaction with hermes for software following the
+*  UDP protocol.
+*
+*  @require: hermes::core
+*            hermes::network::Datagram
+*
+*/
+namespace udp {
+
+/**
+* @brief: UDP multicast sender
+*
+* @description: publishes datagrams to a multicast group. A single send
+* reaches every subscriber which joined the group on the host or on the
+* network segment, according to the time to live.
+*
+* @param:
+*     - group (string) multicast address (e.g: 239.255.0.1 or ff02::1)
+*     - port (string)
+*
+* @link:
+*   https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class MulticastSender {
+ public:
+  // Ctor
+  explicit MulticastSender(const std::string& group, const std::string& port)
+      : endpoint_(asio::ip::make_address(group),
+                  static_cast<unsigned short>(std::stoi(port))),
+        session_(network::Datagram::new_session(service_)) {
+    session_->open(endpoint_.protocol());
+    session_->service().run();
+  }
+
+  // Copy Ctor
+  MulticastSender(const MulticastSender&) = delete;
+  // Assignment operator
+  MulticastSender& operator=(const MulticastSender&) = delete;
+
+  // Dtor
+  ~MulticastSender() noexcept { stop(); }
+
+  // sets the time to live of the datagrams sent.
+  // 1 (the default) keeps the datagrams on the local network segment.
+  void set_ttl(int hops) { session_->set_ttl(hops); }
+
+  // enables or disables the delivery of the datagrams sent to the
+  // subscribers running on this host.
+  void set_loopback(bool enable) { session_->set_loopback(enable); }
+
+  // selects, by its address, the interface used to send the datagrams.
+  void set_interface(const std::string& interface) {
+    session_->set_interface(asio::ip::make_address(interface));
+  }
+
+  // synchronous send of a datagram to the group
+  std::size_t send(const std::string& message) {
+    std::size_t bytes = 0;
+
+    try {
+      bytes = session_->send_to(message, endpoint_);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+    }
+    return bytes;
+  }
+
+  // asynchronous send of a datagram to the group
+  void async_send(const std::string& message) {
+    session_->async_send_to(message, endpoint_);
+  }
+
+  // set the handler which will be invoked when the asynchronous send operation
+  // will be performed.
+  void set_send_handler(
+      const std::function<void(std::size_t, network::Datagram&)>& callback) {
+    session_->set_write_handler(callback);
+  }
+
+  // closes the socket and stops the service.
+  void stop() {
+    auto session = session_;
+    // the socket is closed from the strand, where its operations are running.
+    service_.get_strand().post([session]() { session->close(); });
+    service_.stop();
+  }
+
+ private:
+  // I/O services.
+  core::Service service_;
+  // the multicast group and port to which datagrams are sent.
+  asio::ip::udp::endpoint endpoint_;
+  // The socket used to publish datagrams.
+  network::Datagram::session session_;
+};
+
+/**
+* @brief: UDP multicast receiver
+*
+* @description: subscribes to a multicast group and receives every datagram
+* published to it. Many receivers can listen on the same group and port on a
+* single host.
+*
+* @param:
+*     - group (string) multicast address to join.
+*     - port (string)
+*     - interface (string) address of the interface on which the group is
+*       joined. An empty string lets the operating system choose it.
+*
+* @link:
+*   https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class MulticastReceiver {
+ public:
+  // Ctor
+  explicit MulticastReceiver(const std::string& group, const std::string& port,
+                             const std::string& interface = "")
+      : session_(network::Datagram::new_session(service_)),
+        receive_handler_(nullptr) {
+    auto address = asio::ip::make_address(group);
+    auto any = address.is_v6()
+                   ? asio::ip::address(asio::ip::address_v6::any())
+                   : asio::ip::address(asio::ip::address_v4::any());
+
+    session_->bind(asio::ip::udp::endpoint(
+                       any, static_cast<unsigned short>(std::stoi(port))),
+                   true);
+    join(group, interface);
+  }
+
+  // Copy Ctor
+  MulticastReceiver(const MulticastReceiver&) = delete;
+  // Assignment operator
+  MulticastReceiver& operator=(const MulticastReceiver&) = delete;
+
+  // Dtor
+  ~MulticastReceiver() noexcept { stop(); }
+
+  // joins another multicast group on the same port.
+  void join(const std::string& group, const std::string& interface = "") {
+    session_->join_group(asio::ip::make_address(group),
+                         interface.empty() ? asio::ip::address()
+                                           : asio::ip::make_address(interface));
+  }
+
+  // leaves the given multicast group.
+  void leave(const std::string& group, const std::string& interface = "") {
+    session_->leave_group(
+        asio::ip::make_address(group),
+        interface.empty() ? asio::ip::address()
+                          : asio::ip::make_address(interface));
+  }
+
+  // synchronous receive of a datagram published to the group(s).
+  std::string receive() {
+    std::string received("");
+    asio::ip::udp::endpoint sender;
+
+    try {
+      received = session_->receive_from(sender);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+    }
+    return received;
+  }
+
+  // runs the receiver asynchronously.
+  // Every datagram published to the group(s) is delivered to the receive
+  // handler until the receiver is stopped.
+  //
+  // NOTE: you have to set the receive handler before calling the 'run'
+  //       method.
+  void run() {
+    session_->set_read_handler([this](std::string received,
+                                      const asio::ip::udp::endpoint& sender,
+                                      network::Datagram& datagram) {
+      if (receive_handler_) receive_handler_(received, sender, datagram);
+      datagram.async_receive();
+    });
+    session_->service().run();
+    session_->async_receive();
+  }
+
+  // closes the socket and stops the service.
+  void stop() {
+    auto session = session_;
+    // the socket is closed from the strand, where its operations are running.
+    service_.get_strand().post([session]() { session->close(); });
+    service_.stop();
+  }
+
+  // set the handler which will be invoked for each datagram received by the
+  // asynchronous receiver.
+  void set_receive_handler(
+      const std::function<void(std::string, const asio::ip::udp::endpoint&,
+                               network::Datagram&)>& callback) {
+    receive_handler_ = callback;
+  }
+
+ private:
+  // I/O services.
+  core::Service service_;
+  // The socket bound to the group port.
+  network::Datagram::session session_;
+  // The handler invoked for each datagram received.
+  std::function<void(std::string, const asio::ip::udp::endpoint&,
+                     network::Datagram&)> receive_handler_;
+};
+
+// Hash of an udp endpoint (FNV-1a over the address bytes and the port).
+struct EndpointHash {
+  std::size_t operator()(const asio::ip::udp::endpoint& endpoint) const {
+    std::size_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned char byte) {
+      hash = (hash ^ byte) * 1099511628211ULL;
+    };
+
+    if (endpoint.address().is_v4()) {
+      for (auto byte : endpoint.address().to_v4().to_bytes()) mix(byte);
+    } else {
+      for (auto byte : endpoint.address().to_v6().to_bytes()) mix(byte);
+    }
+    mix(static_cast<unsigned char>(endpoint.port() >> 8));
+    mix(static_cast<unsigned char>(endpoint.port() & 0xff));
+    return hash;
+  }
+};
+
+class Server;
+
+/**
+*   @brief: UDP session
+*
+*   @description: Session is the lightweight state that a udp::Server keeps
+*   for each peer. It is created when the first datagram of the peer is
+*   received and given to the accept handler, as tcp::Server does with a
+*   new connection. Every datagram of the peer is then delivered to the read
+*   handler of its session.
+*   A session sends its datagrams through the server socket, or through a
+*   dedicated socket connected to the peer once it has been promoted.
+*   A session closed, expired or belonging to a stopped server is detached
+*   from the sockets: it can be kept by the user, its sends then fail.
+*
+*/
+class Session : public std::enable_shared_from_this<Session> {
+ public:
+  typedef std::shared_ptr<Session> session;
+
+  // synchronous send of a datagram to the peer.
+  std::size_t send(const std::string& message) {
+    std::size_t bytes = 0;
+
+    try {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (not socket_) throw core::Error::User("Session closed.");
+      bytes = connected_ ? connected_->send(message)
+                         : socket_->send_to(message, peer_);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+    }
+    return bytes;
+  }
+
+  // asynchronous send of a datagram to the peer.
+  void async_send(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (not socket_)
+      core::Error::print("Session closed.");
+    else if (connected_)
+      connected_->async_send_to(message, peer_);
+    else
+      socket_->async_send_to(message, peer_);
+  }
+
+  // sets the callback wich will be invoked with each datagram of the peer.
+  void set_read_handler(
+      const std::function<void(std::string, Session&)>& callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_handler_ = callback;
+  }
+
+  // forgets the peer. The next datagram of the peer creates a new session.
+  void close();
+
+  // returns the endpoint of the peer.
+  const asio::ip::udp::endpoint& peer() const { return peer_; }
+
+  // returns true whether the peer owns a dedicated connected socket.
+  bool is_promoted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connected_ != nullptr;
+  }
+
+  // returns the number of datagrams received from the peer.
+  std::size_t received() const { return received_; }
+
+ private:
+  friend class Server;
+
+  // The server shared by its sessions, reset once the server is stopped so
+  // that a session outliving it never touches it.
+  struct Link {
+    std::mutex mutex;
+    Server* server;
+  };
+
+  // ctor
+  Session(const std::shared_ptr<Link>& link,
+          network::Datagram::session socket,
+          const asio::ip::udp::endpoint& peer)
+      : link_(link),
+        socket_(socket),
+        peer_(peer),
+        received_(0),
+        last_activity_(std::chrono::steady_clock::now()),
+        read_handler_(nullptr) {}
+
+  // delivers a datagram of the peer.
+  void deliver(const std::string& datagram) {
+    ++received_;
+    last_activity_ = std::chrono::steady_clock::now();
+
+    std::function<void(std::string, Session&)> handler;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      handler = read_handler_;
+    }
+    if (handler) handler(datagram, *this);
+  }
+
+  // releases the sockets, which belong to the I/O service of the server.
+  void detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connected_) connected_->close();
+    connected_.reset();
+    socket_.reset();
+  }
+
+  // The server owning the session.
+  std::shared_ptr<Link> link_;
+  // Protects the sockets and the read handler.
+  mutable std::mutex mutex_;
+  // The server socket, reset once the session is detached.
+  network::Datagram::session socket_;
+  // The socket connected to the peer, once promoted.
+  network::Datagram::session connected_;
+  // The peer.
+  asio::ip::udp::endpoint peer_;
+  // Number of datagrams received.
+  std::atomic<std::size_t> received_;
+  // Time of the last datagram received.
+  std::chrono::steady_clock::time_point last_activity_;
+  // The handler invoked with each datagram.
+  std::function<void(std::string, Session&)> read_handler_;
+};
+
+/**
+*   @brief: UDP server
+*
+*   @description: demultiplexes the datagrams received on a port by source
+*   endpoint. Each peer is mapped to a Session in a hash table, so per-peer
+*   handlers run with the same ergonomics as the accept handler of
+*   tcp::Server. The table is only accessed from the strand of the server,
+*   no lock is involved.
+*   Optionally, a peer which sent more datagrams than a threshold is
+*   promoted: a socket connected to it is bound on the server port, the kernel
+*   then routes its datagrams directly to that socket and the replies skip
+*   the route lookup of an unconnected send.
+*   Sessions idle for longer than the idle timeout are forgotten.
+*
+*   @param:
+*     - port to listen on (string)
+*
+*   @link:
+*    https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class Server {
+ public:
   // Ctor
   explicit Server(const std::string& port)
-      : port_(port),
-        strand_(service_.get()),
-        acceptor_(service_.get()),
-        session_(network::Stream::new_session(service_)),
+      : stopped_(false),
+        promote_threshold_(0),
+        idle_timeout_(std::chrono::seconds(60)),
+        link_(std::make_shared<Session::Link>()),
+        socket_(network::Datagram::new_session(service_)),
+        timer_(service_.get()),
+        count_(0),
         accept_handler_(nullptr) {
-    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), std::stoi(port_));
-    acceptor_.open(endpoint.protocol());
-    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true));
-    acceptor_.bind(endpoint);
-    acceptor_.listen();
+    link_->server = this;
+    socket_->bind(
+        asio::ip::udp::endpoint(asio::ip::udp::v4(),
+                                static_cast<unsigned short>(std::stoi(port))),
+        true);
+  }
+
+  // Copy Ctor
+  Server(const Server&) = delete;
+  // Assignment operator
+  Server& operator=(const Server&) = delete;
+
+  // Dtor
+  ~Server() noexcept { stop(); }
+
+  // runs the server asynchronously.
+  //
+  // NOTE: you have to set the accept handler before calling the 'run' method.
+  //       this handler represents the behavior of your server when it receives
+  //       the first datagram of a new peer.
+  void run() {
+    socket_->set_read_handler([this](std::string datagram,
+                                     const asio::ip::udp::endpoint& sender,
+                                     network::Datagram& socket) {
+      dispatch(datagram, sender);
+      if (not stopped_) socket.async_receive();
+    });
+    service_.run();
+    socket_->async_receive();
+    service_.get_strand().post([this]() { arm_timer(); });
+  }
+
+  // stops the server and closes all the sessions.
+  void stop() {
+    if (stopped_.exchange(true)) return;
+    service_.get_strand().post([this]() {
+      core::Error error;
+      timer_.cancel(error.get());
+      socket_->close();
+      for (auto& it : sessions_) it.second->detach();
+      sessions_.clear();
+      count_ = 0;
+    });
+    service_.stop();
+
+    std::lock_guard<std::mutex> lock(link_->mutex);
+    link_->server = nullptr;
+  }
+
+  // set the accept handler.
+  // this handler is invoked with the session of each new peer.
+  void set_accept_handler(
+      const std::function<void(Session::session)>& callback) {
+    accept_handler_ = callback;
+  }
+
+  // sets the number of datagrams after which a peer is promoted to a
+  // dedicated connected socket. 0 (the default) disables the promotion.
+  void set_promote_threshold(std::size_t datagrams) {
+    service_.get_strand().post(
+        [this, datagrams]() { promote_threshold_ = datagrams; });
+  }
+
+  // sets the time after which an idle session is forgotten.
+  // 0 disables the expiration.
+  void set_idle_timeout(const std::chrono::milliseconds& timeout) {
+    service_.get_strand().post([this, timeout]() { idle_timeout_ = timeout; });
+  }
+
+  // returns the number of sessions.
+  std::size_t sessions() const { return count_; }
+
+ private:
+  friend class Session;
+
+  // finds or creates the session of the sender and delivers the datagram.
+  void dispatch(const std::string& datagram,
+                const asio::ip::udp::endpoint& sender) {
+    auto found = sessions_.find(sender);
+
+    if (found == sessions_.end()) {
+      Session::session session(new Session(link_, socket_, sender));
+      found = sessions_.emplace(sender, session).first;
+      count_ = sessions_.size();
+      if (accept_handler_) accept_handler_(session);
+    }
+
+    auto session = found->second;
+    session->deliver(datagram);
+
+    // the read handler may have closed the session.
+    if (promote_threshold_ and not session->connected_ and
+        session->received_ >= promote_threshold_ and sessions_.count(sender))
+      promote(session);
+  }
+
+  // binds a socket connected to the peer on the server port.
+  void promote(const Session::session& session) {
+    auto connected = network::Datagram::new_session(service_);
+
+    try {
+      connected->bind(socket_->socket().local_endpoint(), true);
+      connected->connect(session->peer_);
+    } catch (std::exception& e) {
+      core::Error::print(e.what());
+      return;
+    }
+
+    std::weak_ptr<Session> weak(session);
+    connected->set_read_handler([this, weak](
+        std::string datagram, const asio::ip::udp::endpoint& sender,
+        network::Datagram& socket) {
+      auto session = weak.lock();
+      if (not session or stopped_) return;
+      session->deliver(datagram);
+      socket.async_receive();
+    });
+    {
+      std::lock_guard<std::mutex> lock(session->mutex_);
+      session->connected_ = connected;
+    }
+    connected->async_receive();
+  }
+
+  // removes the session of the given peer, from the strand.
+  void remove(const asio::ip::udp::endpoint& peer) {
+    service_.get_strand().dispatch([this, peer]() {
+      auto found = sessions_.find(peer);
+      if (found == sessions_.end()) return;
+      found->second->detach();
+      sessions_.erase(found);
+      count_ = sessions_.size();
+    });
+  }
+
+  // forgets the sessions idle for longer than the idle timeout.
+  void arm_timer() {
+    if (stopped_ or not idle_timeout_.count()) return;
+
+    timer_.expires_after(idle_timeout_ / 2);
+    timer_.async_wait(
+        service_.get_strand().wrap([this](const asio::error_code& error) {
+          if (error) return;
+
+          auto now = std::chrono::steady_clock::now();
+          for (auto it = sessions_.begin(); it != sessions_.end();) {
+            if (now - it->second->last_activity_ > idle_timeout_) {
+              it->second->detach();
+              it = sessions_.erase(it);
+            } else {
+              ++it;
+            }
+          }
+          count_ = sessions_.size();
+          arm_timer();
+        }));
+  }
+
+  // Indicates if the server is stopped.
+  std::atomic<bool> stopped_;
+  // Number of datagrams after which a peer is promoted. The settings are
+  // only accessed from the strand.
+  std::size_t promote_threshold_;
+  // Time after which an idle session is forgotten.
+  std::chrono::milliseconds idle_timeout_;
+  // The link shared with the sessions.
+  std::shared_ptr<Session::Link> link_;
+  // I/O services.
+  core::Service service_;
+  // The socket bound to the server port.
+  network::Datagram::session socket_;
+  // Idle sessions timer.
+  asio::steady_timer timer_;
+  // The sessions, by peer. Only accessed from the strand.
+  std::unordered_map<asio::ip::udp::endpoint, Session::session, EndpointHash>
+      sessions_;
+  // Number of sessions, readable from any thread.
+  std::atomic<std::size_t> count_;
+  // The handler invoked with the session of each new peer.
+  std::function<void(Session::session)> accept_handler_;
+};
+
+inline void Session::close() {
+  std::lock_guard<std::mutex> lock(link_->mutex);
+  if (link_->server) link_->server->remove(peer_);
+}
+
+/**
+* @brief: Reliable UDP socket
+*
+* @description: Reliable adds an optional reliability layer on top of the
+* UDP transport, to avoid both the losses of raw UDP and the head-of-line
+* blocking of TCP on lossy links.
+* Each message is carried by a single datagram holding a sequence number.
+* The receiver acknowledges every datagram with its cumulative acknowledgment
+* and a bitmap of the 32 following sequence numbers already received
+* (selective ACK), so the sender only retransmits the datagrams which are
+* really missing. The number of unacknowledged datagrams per peer is bounded
+* by a window, the messages sent beyond it wait in a backlog.
+* Messages are delivered to the receive handler either in order or as soon
+* as they arrive (unordered), duplicates are never delivered.
+* A message retransmitted too many times is given up: it is reported to the
+* failure handler and the receiver is told to stop waiting for it, so the
+* following messages are still delivered in ordered mode. The state of the
+* peers without traffic is forgotten after a timeout.
+*
+* All the state of a Reliable object is driven by the strand of its service,
+* so no lock is involved on the data path.
+*
+* @param:
+*     - port (string) local port to bind, "0" for an ephemeral one.
+*     - ordered (bool) delivers the messages of a peer in the order they
+*       have been sent.
+*
+* @link:
+*   https://github.com/TommyStarK/Hermes/blob/master/DESIGN.md
+*/
+class Reliable {
+ public:
+  // Ctor
+  explicit Reliable(const std::string& port = "0", bool ordered = true)
+      : ordered_(ordered),
+        stopped_(false),
+        window_(64),
+        max_retransmits_(10),
+        timeout_(std::chrono::milliseconds(200)),
+        peer_timeout_(std::chrono::seconds(60)),
+        session_(network::Datagram::new_session(service_)),
+        timer_(service_.get()),
+        receive_handler_(nullptr),
+        failure_handler_(nullptr) {
+    session_->bind(asio::ip::udp::endpoint(
+        asio::ip::udp::v4(), static_cast<unsigned short>(std::stoi(port))));
+  }
+
+  // Copy Ctor
+  Reliable(const Reliable&) = delete;
+  // Assignment operator
+  Reliable& operator=(const Reliable&) = delete;
+
+  // Dtor
+  ~Reliable() noexcept { stop(); }
+
+  // runs the reliable socket: starts receiving datagrams and retransmitting
+  // the unacknowledged ones.
+  //
+  // NOTE: you have to set the receive handler before calling the 'run'
+  //       method.
+  void run() {
+    session_->set_read_handler([this](std::string datagram,
+                                      const asio::ip::udp::endpoint& sender,
+                                      network::Datagram& session) {
+      if (not datagram.empty()) {
+        if (datagram[0] == DATA) on_data(datagram, sender);
+        if (datagram[0] == ACK) on_ack(datagram, sender);
+        if (datagram[0] == SKIP) on_skip(datagram, sender);
+      }
+      if (not stopped_) session.async_receive();
+    });
+    session_->service().run();
+    session_->async_receive();
+    service_.get_strand().post([this]() { arm_timer(); });
+  }
+
+  // stops the socket. Unacknowledged messages are dropped.
+  void stop() {
+    if (stopped_.exchange(true)) return;
+    service_.get_strand().post([this]() {
+      core::Error error;
+      timer_.cancel(error.get());
+      session_->close();
+    });
+    service_.stop();
+  }
+
+  // asynchronous and reliable send of a message to the given peer.
+  // The message is retransmitted until the peer acknowledges it, or until
+  // the maximum number of retransmissions is reached.
+  void send(const std::string& message,
+            const asio::ip::udp::endpoint& endpoint) {
+    if (message.size() > core::DATAGRAM_SIZE - HEADER_SIZE)
+      throw core::Error::User(
+          "Message too large to fit in a single reliable datagram.");
+
+    service_.get_strand().post([this, message, endpoint]() {
+      auto& peer = peers_[endpoint];
+      peer.backlog.push_back(message);
+      flush(peer, endpoint);
+    });
+  }
+
+  // same as above, the peer is resolved from the given host and port.
+  void send(const std::string& message, const std::string& host,
+            const std::string& port) {
+    asio::ip::udp::resolver resolver(service_.get());
+    send(message,
+         *resolver.resolve(asio::ip::udp::resolver::query(
+             asio::ip::udp::v4(), host, port)));
+  }
+
+  // sets the maximum number of unacknowledged messages per peer.
+  void set_window(std::size_t window) {
+    service_.get_strand().post(
+        [this, window]() { window_ = window ? window : 1; });
+  }
+
+  // sets the initial retransmission timeout. It is doubled for each
+  // retransmission of the same message.
+  void set_retransmit_timeout(const std::chrono::milliseconds& timeout) {
+    service_.get_strand().post([this, timeout]() { timeout_ = timeout; });
+  }
+
+  // sets the number of retransmissions after which a message is dropped.
+  void set_max_retransmits(unsigned int retransmits) {
+    service_.get_strand().post(
+        [this, retransmits]() { max_retransmits_ = retransmits; });
+  }
+
+  // sets the time after which the state of an idle peer is forgotten.
+  void set_peer_timeout(const std::chrono::milliseconds& timeout) {
+    service_.get_strand().post([this, timeout]() { peer_timeout_ = timeout; });
+  }
+
+  // set the handler which will be invoked for each message received.
+  void set_receive_handler(
+      const std::function<void(std::string, const asio::ip::udp::endpoint&,
+                               Reliable&)>& callback) {
+    receive_handler_ = callback;
+  }
+
+  // set the handler which will be invoked with each message dropped because
+  // the peer never acknowledged it.
+  void set_failure_handler(
+      const std::function<void(std::string, const asio::ip::udp::endpoint&)>&
+          callback) {
+    failure_handler_ = callback;
+  }
+
+  // returns the local endpoint of the socket.
+  asio::ip::udp::endpoint local_endpoint() {
+    return session_->socket().local_endpoint();
+  }
+
+ private:
+  // datagram types.
+  enum : char { DATA = 1, ACK = 2, SKIP = 3 };
+
+  // type (1 byte) + sequence number (4 bytes) + floor (4 bytes).
+  // The floor is the lowest sequence number the sender still retransmits,
+  // everything before it has been either acknowledged or given up.
+  static std::size_t const HEADER_SIZE = 9;
+
+  // type (1 byte) + cumulative acknowledgment (4 bytes) + bitmap (4 bytes).
+  static std::size_t const ACK_SIZE = 9;
+
+  // type (1 byte) + floor (4 bytes).
+  static std::size_t const SKIP_SIZE = 5;
+
+  // number of sequence numbers acknowledged by the selective ACK bitmap.
+  static std::uint32_t const SACK_SIZE = 32;
+
+  // bound of the sequence numbers buffered beyond the expected one.
+  static std::uint32_t const REORDER_LIMIT = 1024;
+
+  // A message sent and not acknowledged yet.
+  struct Outgoing {
+    std::string datagram;
+    std::chrono::steady_clock::time_point sent;
+    unsigned int retransmits;
+  };
+
+  // The state kept for each peer.
+  struct Peer {
+    // sending side.
+    std::uint32_t next_sequence = 0;
+    std::map<std::uint32_t, Outgoing> unacked;
+    std::deque<std::string> backlog;
+    // cumulative acknowledgment last received from the peer.
+    std::uint32_t acknowledged = 0;
+    // sequence number following the last message given up, and the SKIP
+    // datagrams sent to move the peer past it.
+    std::uint32_t gap = 0;
+    unsigned int skips = 0;
+    std::chrono::steady_clock::time_point skipped;
+    std::chrono::steady_clock::time_point sending;
+    // receiving side, only meaningful once the first datagram is received.
+    bool receiving = false;
+    std::uint32_t expected = 0;
+    std::map<std::uint32_t, std::string> received;
+    std::chrono::steady_clock::time_point receiving_since;
+  };
+
+  // serial number arithmetic, robust to the wrap around of sequence numbers.
+  static bool before(std::uint32_t a, std::uint32_t b) {
+    return static_cast<std::int32_t>(a - b) < 0;
+  }
+
+  // returns the lowest sequence number still retransmitted to the peer.
+  static std::uint32_t floor(const Peer& peer) {
+    auto lowest = peer.next_sequence;
+    for (const auto& it : peer.unacked)
+      if (before(it.first, lowest)) lowest = it.first;
+    return lowest;
+  }
+
+  // sends the messages of the backlog while the window allows it.
+  void flush(Peer& peer, const asio::ip::udp::endpoint& endpoint) {
+    while (not peer.backlog.empty() and peer.unacked.size() < window_) {
+      std::string datagram(1, DATA);
+      core::put_integer(datagram, peer.next_sequence);
+      core::put_integer(datagram, floor(peer));
+      datagram += peer.backlog.front();
+      peer.backlog.pop_front();
+
+      peer.sending = std::chrono::steady_clock::now();
+      peer.unacked[peer.next_sequence++] = Outgoing{datagram, peer.sending, 0};
+      session_->async_send_to(datagram, endpoint);
+    }
+  }
+
+  // returns the state of the peer a DATA or SKIP datagram comes from. The
+  // receiving side of a new (or forgotten) peer starts at the floor of the
+  // sender.
+  Peer& receiving(const asio::ip::udp::endpoint& endpoint,
+                  std::uint32_t floor) {
+    auto& peer = peers_[endpoint];
+    if (not peer.receiving) {
+      peer.receiving = true;
+      peer.expected = floor;
+    }
+    peer.receiving_since = std::chrono::steady_clock::now();
+    return peer;
+  }
+
+  // handles a DATA datagram: delivers the message(s) and acknowledges.
+  void on_data(const std::string& datagram,
+               const asio::ip::udp::endpoint& endpoint) {
+    if (datagram.size() < HEADER_SIZE) return;
+
+    auto sequence = core::get_integer<std::uint32_t>(datagram, 1);
+    auto floor = core::get_integer<std::uint32_t>(datagram, 5);
+    auto& peer = receiving(endpoint, floor);
+
+    skip(peer, floor, endpoint);
+
+    if (sequence == peer.expected) {
+      deliver(datagram.substr(HEADER_SIZE), endpoint);
+      ++peer.expected;
+      drain(peer, endpoint);
+    } else if (before(peer.expected, sequence) and
+               sequence - peer.expected < REORDER_LIMIT and
+               not peer.received.count(sequence)) {
+      if (ordered_) {
+        peer.received[sequence] = datagram.substr(HEADER_SIZE);
+      } else {
+        peer.received[sequence] = "";
+        deliver(datagram.substr(HEADER_SIZE), endpoint);
+      }
+    }
+    // duplicates and out of window datagrams are only acknowledged.
+
+    acknowledge(peer, endpoint);
   }
 
-  // Copy Ctor
-  Server(const Server&) = delete;
-  // Assignment operator
-  Server& operator=(const Server&) = delete;
+  // handles a SKIP datagram: the sender gave up on the messages before the
+  // floor, so they are not waited for anymore.
+  void on_skip(const std::string& datagram,
+               const asio::ip::udp::endpoint& endpoint) {
+    if (datagram.size() < SKIP_SIZE) return;
 
-  // Dtor
-  ~Server() noexcept { stop(); }
+    auto floor = core::get_integer<std::uint32_t>(datagram, 1);
+    auto& peer = receiving(endpoint, floor);
 
-  // run the server
-  //
-  // @param:
-  //    - bool async
-  //
-  // If you run the server with 'false' as parameter, you will run an iterative
-  // server, it means that you could handle only one connection at a time.
-  // Otherwise, run the server with 'true' to be able to handle many connections
-  // asynchronously.
-  //
-  // NOTE: you have to set the accept handler before calling the 'run' method.
-  //       this handler represents the behavior of your server when it accepts
-  //       a new connection.
-  //
-  void run(bool async) {
-    try {
-      if (not acceptor_.is_open())
-        throw core::Error::Connection(
-            "Unexpected error occured."
-            " Cannot open asio::ip::tcp::acceptor. Operation aborted.");
+    skip(peer, floor, endpoint);
+    acknowledge(peer, endpoint);
+  }
 
-      if (not async) {
-        core::Error error;
+  // moves the expected sequence number up to the floor of the sender,
+  // delivering (ordered mode) the messages received before it.
+  void skip(Peer& peer, std::uint32_t floor,
+            const asio::ip::udp::endpoint& endpoint) {
+    if (not before(peer.expected, floor)) return;
+
+    // the messages buffered are all within REORDER_LIMIT of the expected one.
+    auto distance = floor - peer.expected;
+    if (distance > REORDER_LIMIT) distance = REORDER_LIMIT;
+    for (std::uint32_t i = 0; i < distance; ++i) {
+      auto it = peer.received.find(peer.expected + i);
+      if (it == peer.received.end()) continue;
+      if (ordered_) deliver(it->second, endpoint);
+      peer.received.erase(it);
+    }
+    peer.expected = floor;
+    drain(peer, endpoint);
+  }
 
-        session_->service().run();
-        acceptor_.accept(session_->socket(), error.get());
-        if (error.exist()) error.throw_it();
-        if (accept_handler_) accept_handler_(std::move(session_));
-        session_.reset();
-        session_ = network::Stream::new_session(service_);
-        return;
+  // delivers (ordered mode) the messages which were waiting for the expected
+  // one.
+  void drain(Peer& peer, const asio::ip::udp::endpoint& endpoint) {
+    for (auto it = peer.received.find(peer.expected);
+         it != peer.received.end(); it = peer.received.find(peer.expected)) {
+      if (ordered_) deliver(it->second, endpoint);
+      peer.received.erase(it);
+      ++peer.expected;
+    }
+  }
 
-      } else {
-        // in the case where the run method is called with true as parameter
-        // we post through the server strand object a handler which contains
-        // the async accept. This handler is posted through the strand object to
-        // ensure that there will be at least one connection accepted.
-        strand_.post(std::bind(&Server::handler, this));
-      }
-    } catch (std::exception& e) {
-      core::Error::print(e.what());
+  // sends the cumulative acknowledgment and the selective ACK bitmap.
+  void acknowledge(Peer& peer, const asio::ip::udp::endpoint& endpoint) {
+    std::string ack(1, ACK);
+    std::uint32_t bitmap = 0;
+    for (std::uint32_t i = 0; i < SACK_SIZE; ++i)
+      if (peer.received.count(peer.expected + 1 + i)) bitmap |= (1u << i);
+    core::put_integer(ack, peer.expected);
+    core::put_integer(ack, bitmap);
+    session_->async_send_to(ack, endpoint);
+  }
+
+  // handles an ACK datagram: releases the acknowledged messages.
+  void on_ack(const std::string& datagram,
+              const asio::ip::udp::endpoint& endpoint) {
+    if (datagram.size() < ACK_SIZE) return;
+
+    auto found = peers_.find(endpoint);
+    if (found == peers_.end()) return;
+
+    auto& peer = found->second;
+    auto cumulative = core::get_integer<std::uint32_t>(datagram, 1);
+    auto bitmap = core::get_integer<std::uint32_t>(datagram, 5);
+
+    if (before(peer.acknowledged, cumulative)) peer.acknowledged = cumulative;
+    peer.sending = std::chrono::steady_clock::now();
+
+    for (auto it = peer.unacked.begin(); it != peer.unacked.end();) {
+      auto offset = it->first - cumulative - 1;
+      if (before(it->first, cumulative) or
+          (offset < SACK_SIZE and (bitmap & (1u << offset))))
+        it = peer.unacked.erase(it);
+      else
+        ++it;
     }
+    flush(peer, endpoint);
   }
 
-  // stops the server
-  void stop() {
-    session_->disconnect();
-    service_.stop();
+  void deliver(const std::string& message,
+               const asio::ip::udp::endpoint& endpoint) {
+    if (receive_handler_) receive_handler_(message, endpoint, *this);
   }
 
-  // set the accept handler.
-  // this handler represents the server's behavior when it accepts a new
-  // connection.
-  void set_accept_handler(
-      const std::function<void(network::Stream::session)>& callback) {
-    accept_handler_ = callback;
+  // retransmits the messages whose timeout is expired, tells the peers about
+  // the messages given up and forgets the idle peers.
+  void retransmit() {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto it = peers_.begin(); it != peers_.end();) {
+      auto& peer = it->second;
+      auto lowest = floor(peer);
+
+      for (auto out = peer.unacked.begin(); out != peer.unacked.end();) {
+        auto& outgoing = out->second;
+
+        if (now - outgoing.sent < timeout_ * (1 << std::min(
+                                                   outgoing.retransmits, 6u))) {
+          ++out;
+          continue;
+        }
+
+        if (outgoing.retransmits >= max_retransmits_) {
+          if (failure_handler_)
+            failure_handler_(outgoing.datagram.substr(HEADER_SIZE), it->first);
+          if (not before(out->first, peer.gap)) {
+            peer.gap = out->first + 1;
+            peer.skips = 0;
+          }
+          out = peer.unacked.erase(out);
+          continue;
+        }
+
+        // refreshes the floor carried by the datagram.
+        std::string header;
+        core::put_integer(header, lowest);
+        outgoing.datagram.replace(5, 4, header);
+
+        ++outgoing.retransmits;
+        outgoing.sent = now;
+        peer.sending = now;
+        session_->async_send_to(outgoing.datagram, it->first);
+        ++out;
+      }
+      flush(peer, it->first);
+
+      // the peer still waits for a message given up: the floor is sent in a
+      // SKIP datagram (also carried by the next DATA datagrams).
+      lowest = floor(peer);
+      if (before(peer.acknowledged, peer.gap) and
+          before(peer.acknowledged, lowest) and
+          peer.skips <= max_retransmits_ and now - peer.skipped >= timeout_) {
+        std::string datagram(1, SKIP);
+        core::put_integer(datagram, lowest);
+        ++peer.skips;
+        peer.skipped = now;
+        peer.sending = now;
+        session_->async_send_to(datagram, it->first);
+      }
+
+      // the receiving side is forgotten first: the sender of an idle peer
+      // keeps its sequence numbers long enough for the receiver to start
+      // over from the floor of the next datagram.
+      if (peer.receiving and now - peer.receiving_since >= peer_timeout_) {
+        peer.receiving = false;
+        peer.received.clear();
+      }
+      if (not peer.receiving and peer.unacked.empty() and
+          peer.backlog.empty() and now - peer.sending >= 2 * peer_timeout_)
+        it = peers_.erase(it);
+      else
+        ++it;
+    }
   }
 
- private:
-  // Performs the async accept.
-  // once the socket is accepted and the connection made, the session_ is moved to
-  // the accept handler. As this is a shared_ptr, the connection will remain
-  // until there is operation on it. Then we reset the session_ and call again
-  // the handler method to accept a new connection.
-  void handler() {
-    acceptor_.async_accept(
-        session_->socket(), session_->service().get_strand().wrap([this](
-                                const asio::error_code& error) {
+  // the retransmission timer ticks every quarter of the timeout.
+  void arm_timer() {
+    if (stopped_) return;
 
-          if (error) throw asio::system_error(error);
+    auto period = timeout_ / 4;
+    if (period < std::chrono::milliseconds(1))
+      period = std::chrono::milliseconds(1);
 
-          // This part is scope locked and a mutex is used to
-          // ensure the thread safety and avoid concurrencies issues of the
-          // accept handler.
-          std::mutex mutex;
-          std::lock_guard<std::mutex> lock(mutex);
-          {
-            if (accept_handler_) accept_handler_(std::move(session_));
-            session_.reset();
-            session_ = network::Stream::new_session(service_);
-          }
-          // we call the function itself to accept a new connection.
-          handler();
+    timer_.expires_after(period);
+    timer_.async_wait(
+        service_.get_strand().wrap([this](const asio::error_code& error) {
+          if (error) return;
+          retransmit();
+          arm_timer();
         }));
   }
 
-  // The port to which the server is listenning on.
-  std::string port_;
+  // delivers the messages of a peer in order.
+  bool ordered_;
+  // Indicates if the socket is stopped.
+  std::atomic<bool> stopped_;
+  // maximum number of unacknowledged messages per peer. The settings are only
+  // accessed from the strand.
+  std::size_t window_;
+  // number of retransmissions before a message is dropped.
+  unsigned int max_retransmits_;
+  // initial retransmission timeout.
+  std::chrono::milliseconds timeout_;
+  // time after which the state of an idle peer is forgotten.
+  std::chrono::milliseconds peer_timeout_;
   // I/O services.
   core::Service service_;
-  // Dedicated strand object for the server.
-  asio::io_context::strand strand_;
-  // Acceptor, the Asio facilitator to accept socket and enable tcp connection.
-  asio::ip::tcp::acceptor acceptor_;
-  // A connection to a client
-  network::Stream::session session_;
-  // The handler invoked when the asynchronous accept is performed.
-  std::function<void(network::Stream::session)> accept_handler_;
+  // The underlying UDP socket.
+  network::Datagram::session session_;
+  // Retransmission timer.
+  asio::steady_timer timer_;
+  // The state of each peer, only accessed from the strand.
+  std::map<asio::ip::udp::endpoint, Peer> peers_;
+  // The handler invoked for each message received.
+  std::function<void(std::string, const asio::ip::udp::endpoint&, Reliable&)>
+      receive_handler_;
+  // The handler invoked for each message dropped.
+  std::function<void(std::string, const asio::ip::udp::endpoint&)>
+      failure_handler_;
 };
 
-}  // namespace tcp
+}  // namespace udp
 
 /**
 *   @brief: Hermes protobuf operations.
@@ -837,9 +6054,12 @@ class Server {
 namespace protobuf {
 
 // synchronous send of a serialized protobuf message
+// With fast_open, the message can leave with the SYN, cf:
+// network::Stream::set_fast_open. It may then be delivered twice: only for
+// idempotent messages.
 template <typename T>
 std::size_t send(const std::string& host, const std::string& port,
-                 const T& message) {
+                 const T& message, bool fast_open = false) {
   core::Service service;
 
   auto session = network::Stream::new_session(service);
@@ -849,10 +6069,9 @@ std::size_t send(const std::string& host, const std::string& port,
 
   try {
     session->service().run();
+    session->set_fast_open(fast_open);
     message.SerializeToString(&protobuf);
-    asio::ip::tcp::resolver resolver(service.get());
-    session->connect(
-        *resolver.resolve(asio::ip::tcp::resolver::query(host, port)));
+    session->connect(network::Resolver::shared().resolve(host, port));
     bytes = session->send(protobuf);
   } catch (std::exception& e) {
     core::Error::print(e.what());
@@ -887,10 +6106,12 @@ T receive(const std::string& port) {
 // asynchronous send of a serialized protobuf message
 // a callback could be provided like a std::function or a lambda, as parameter.
 // the callback will be invoked when the asynchronous send will be performed.
+// fast_open, cf: send.
 template <typename T>
 void async_send(const std::string& host, const std::string& port,
                 const T& message,
-                const std::function<void(std::size_t)>& callback = nullptr) {
+                const std::function<void(std::size_t)>& callback = nullptr,
+                bool fast_open = false) {
   core::Service service;
   std::string protobuf("");
   auto session = network::Stream::new_session(service);
@@ -900,12 +6121,12 @@ void async_send(const std::string& host, const std::string& port,
 
   try {
     message.SerializeToString(&protobuf);
-    asio::ip::tcp::resolver resolver(service.get());
-    session->async_connect(
-        *resolver.resolve(asio::ip::tcp::resolver::query(host, port)));
+    session->set_fast_open(fast_open);
     session->set_write_handler(handler);
-    session->async_send(protobuf);
-    session->disconnect();
+    session->async_connect(
+        network::Resolver::shared().resolve(host, port),
+        [protobuf](network::Stream& stream) { stream.async_send(protobuf); });
+    // waits for the pending operations to complete.
     session->service().stop();
   } catch (std::exception& e) {
     core::Error::print(e.what());
@@ -947,6 +6168,450 @@ void async_receive(const std::string& port,
   }
 }
 
+
+// I/O service shared by the future-returning protobuf operations.
+// Its dedicated thread completes the futures. It is started once, by the
+// thread-safe initialization of the function-local static.
+inline core::Service& default_service() {
+  struct Running {
+    Running() { service.run(); }
+    core::Service service;
+  };
+  static Running running;
+
+  return running.service;
+}
+
+// asynchronous send of a serialized protobuf message returning a future.
+// the function returns immediately, the future is completed from the I/O
+// thread with the number of bytes sent, or holds the error of the operation.
+// The connection is gracefully closed once the message is sent.
+// the operation runs on the given service, which can be shared with other
+// operations and clients, and must outlive the operation.
+// fast_open, cf: send.
+template <typename T>
+std::future<std::size_t> send_async(core::Service& service,
+                                    const std::string& host,
+                                    const std::string& port,
+                                    const T& message, bool fast_open = false) {
+  auto promise = std::make_shared<std::promise<std::size_t>>();
+  auto future = promise->get_future();
+
+  try {
+    std::string protobuf("");
+    service.run();
+    auto session = network::Stream::new_session(service);
+
+    message.SerializeToString(&protobuf);
+    session->set_fast_open(fast_open);
+
+    // connection failure.
+    session->set_error_handler(
+        [promise](const asio::error_code& error, network::Stream& stream) {
+          core::complete(*promise, error, std::size_t(0));
+        });
+
+    // the name resolution does not block the caller either.
+    network::Resolver::shared().async_resolve(
+        host, port, [promise, session, protobuf](
+                        const asio::error_code& error,
+                        const network::Resolver::endpoints& endpoints) {
+          if (error) return core::complete(*promise, error, std::size_t(0));
+
+          session->async_connect(endpoints, [promise, protobuf](
+                                                network::Stream& stream) {
+            stream.async_send(protobuf, [promise, &stream](
+                                            const asio::error_code& error,
+                                            std::size_t bytes) {
+              core::complete(*promise, error, bytes);
+              stream.async_disconnect();
+            });
+          });
+        });
+  } catch (std::exception& e) {
+    promise->set_exception(std::current_exception());
+  }
+  return future;
+}
+
+// asynchronous receive of a protobuf message returning a future.
+// the function returns immediately, the future is completed from the I/O
+// thread with the message, once the sender has closed the connection, or
+// holds the error of the operation.
+// the operation runs on the given service, which can be shared with other
+// operations and clients, and must outlive the operation.
+template <typename T>
+std::future<T> receive_async(core::Service& service, const std::string& port) {
+  auto promise = std::make_shared<std::promise<T>>();
+  auto future = promise->get_future();
+
+  try {
+    service.run();
+    auto session = network::Stream::new_session(service);
+    auto acceptor = std::make_shared<asio::ip::tcp::acceptor>(service.get());
+    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), std::stoi(port));
+
+    acceptor->open(endpoint.protocol());
+    acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true));
+    acceptor->bind(endpoint);
+    acceptor->listen();
+    acceptor->async_accept(session->socket(), [promise, acceptor, session](
+                                                  const asio::error_code& error) {
+      if (error) {
+        core::complete(*promise, error, T());
+        return;
+      }
+
+      auto received = std::make_shared<std::string>();
+      asio::async_read(
+          session->socket(), asio::dynamic_buffer(*received),
+          [promise, session, received](const asio::error_code& error,
+                                       std::size_t bytes) {
+            // the message is complete once the sender closes the connection.
+            T result;
+            if (not error or error == asio::error::eof)
+              result.ParseFromString(*received);
+            core::complete(*promise,
+                           error == asio::error::eof ? asio::error_code() : error,
+                           result);
+          });
+    });
+  } catch (std::exception& e) {
+    promise->set_exception(std::current_exception());
+  }
+  return future;
+}
+
+// same as above, on the I/O service shared by the protobuf operations.
+template <typename T>
+std::future<std::size_t> send_async(const std::string& host,
+                                    const std::string& port,
+                                    const T& message, bool fast_open = false) {
+  return send_async<T>(default_service(), host, port, message, fast_open);
+}
+
+// same as above, on the I/O service shared by the protobuf operations.
+template <typename T>
+std::future<T> receive_async(const std::string& port) {
+  return receive_async<T>(default_service(), port);
+}
+
+/**
+*   @brief: Hermes protobuf operations over UDP.
+*
+*   @description: send/receive serialized protobuf messages without the cost
+*   of a TCP connection, e.g: fire-and-forget telemetry.
+*   Each serialized message is split into fragments which fit in a single
+*   datagram without being fragmented by IP. A small message is sent in one
+*   datagram. Every fragment starts with an header:
+*
+*     | message id (4 bytes) | index (2 bytes) | count (2 bytes) | data |
+*
+*   The receiver reassembles the fragments of each message in a bounded table.
+*   A message whose fragments do not all arrive before the timeout is dropped,
+*   as UDP does not retransmit anything.
+*
+*/
+namespace udp {
+
+// header size of a fragment.
+static std::size_t const HEADER_SIZE = 8;
+
+// Maximum size of the data carried by a fragment.
+// Keeps the datagrams under the usual ethernet MTU.
+static std::size_t const FRAGMENT_SIZE = 1400;
+
+// Maximum number of fragments of a message (about 1.4MB). Bounds the memory
+// an untrusted header can make the receiver allocate.
+static std::size_t const MAX_FRAGMENTS = 1024;
+
+/**
+*   @brief: Reassembly table of the fragmented messages.
+*
+*   @description: gathers the fragments of the messages being received, keyed
+*   by sender and message id. The table is bounded: when it is full, the oldest
+*   incomplete message is dropped, and the incomplete messages older than the
+*   timeout are dropped as well.
+*
+*/
+class Reassembler {
+ public:
+  // Ctor
+  explicit Reassembler(
+      std::size_t capacity = 64,
+      const std::chrono::milliseconds& timeout = std::chrono::seconds(1))
+      : capacity_(capacity ? capacity : 1), timeout_(timeout) {}
+
+  // feeds a datagram to the table.
+  // returns true and fills message once all the fragments of a message have
+  // been received.
+  bool feed(const std::string& datagram,
+            const asio::ip::udp::endpoint& sender, std::string& message) {
+    if (datagram.size() < HEADER_SIZE) return false;
+
+    auto id = core::get_integer<std::uint32_t>(datagram, 0);
+    auto index = core::get_integer<std::uint16_t>(datagram, 4);
+    auto count = core::get_integer<std::uint16_t>(datagram, 6);
+
+    if (not count or index >= count or count > MAX_FRAGMENTS) return false;
+
+    if (count == 1) {
+      message = datagram.substr(HEADER_SIZE);
+      return true;
+    }
+
+    // fragments are never larger than what the senders produce.
+    if (datagram.size() > HEADER_SIZE + FRAGMENT_SIZE) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    expire(now);
+
+    auto key = std::make_pair(sender, id);
+    auto found = pending_.find(key);
+
+    if (found == pending_.end()) {
+      if (pending_.size() >= capacity_) evict_oldest();
+      found = pending_.emplace(key, Pending()).first;
+      found->second.started = now;
+      found->second.fragments.resize(count);
+      found->second.received.assign(count, false);
+      found->second.remaining = count;
+    }
+
+    auto& entry = found->second;
+    if (entry.fragments.size() != count or entry.received[index]) return false;
+
+    entry.fragments[index] = datagram.substr(HEADER_SIZE);
+    entry.received[index] = true;
+    if (--entry.remaining) return false;
+
+    message.clear();
+    for (const auto& fragment : entry.fragments) message += fragment;
+    pending_.erase(found);
+    return true;
+  }
+
+  // returns the number of incomplete messages.
+  std::size_t size() const { return pending_.size(); }
+
+ private:
+  // A message being reassembled.
+  struct Pending {
+    std::chrono::steady_clock::time_point started;
+    std::vector<std::string> fragments;
+    std::vector<bool> received;
+    std::size_t remaining;
+  };
+
+  typedef std::pair<asio::ip::udp::endpoint, std::uint32_t> Key;
+
+  // drops the incomplete messages older than the timeout.
+  void expire(const std::chrono::steady_clock::time_point& now) {
+    for (auto it = pending_.begin(); it != pending_.end();)
+      if (now - it->second.started > timeout_)
+        it = pending_.erase(it);
+      else
+        ++it;
+  }
+
+  void evict_oldest() {
+    auto oldest = pending_.begin();
+    for (auto it = pending_.begin(); it != pending_.end(); ++it)
+      if (it->second.started < oldest->second.started) oldest = it;
+    if (oldest != pending_.end()) pending_.erase(oldest);
+  }
+
+  // Maximum number of incomplete messages.
+  std::size_t capacity_;
+  // Time given to a message to receive all its fragments.
+  std::chrono::milliseconds timeout_;
+  // The incomplete messages.
+  std::map<Key, Pending> pending_;
+};
+
+// splits a serialized message into datagrams.
+inline std::vector<std::string> fragment(const std::string& protobuf) {
+  static std::atomic<std::uint32_t> next_id(static_cast<std::uint32_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count()));
+
+  auto count = protobuf.empty() ? 1 : (protobuf.size() + FRAGMENT_SIZE - 1) /
+                                          FRAGMENT_SIZE;
+  if (count > MAX_FRAGMENTS)
+    throw core::Error::User("Message too large to be sent over UDP.");
+
+  auto id = next_id++;
+  std::vector<std::string> datagrams;
+
+  for (std::size_t index = 0; index < count; ++index) {
+    std::string datagram;
+    core::put_integer(datagram, id);
+    core::put_integer(datagram, static_cast<std::uint16_t>(index));
+    core::put_integer(datagram, static_cast<std::uint16_t>(count));
+    datagram += protobuf.substr(index * FRAGMENT_SIZE, FRAGMENT_SIZE);
+    datagrams.push_back(datagram);
+  }
+  return datagrams;
+}
+
+// resolves the udp endpoint of the given host:port.
+inline asio::ip::udp::endpoint resolve(core::Service& service,
+                                       const std::string& host,
+                                       const std::string& port) {
+  asio::ip::udp::resolver resolver(service.get());
+  return *resolver.resolve(asio::ip::udp::resolver::query(host, port));
+}
+
+// synchronous send of a serialized protobuf message over UDP.
+// returns the number of bytes of the serialized message, 0 on error.
+template <typename T>
+std::size_t send(const std::string& host, const std::string& port,
+                 const T& message) {
+  core::Service service;
+  auto session = network::Datagram::new_session(service);
+
+  std::size_t bytes = 0;
+  std::string protobuf("");
+
+  try {
+    message.SerializeToString(&protobuf);
+    auto endpoint = resolve(service, host, port);
+    for (const auto& datagram : fragment(protobuf))
+      session->send_to(datagram, endpoint);
+    bytes = protobuf.size();
+  } catch (std::exception& e) {
+    core::Error::print(e.what());
+  }
+  return bytes;
+}
+
+// asynchronous send of a serialized protobuf message over UDP.
+// the function returns once the fragments are queued, they are sent from the
+// I/O thread shared by the protobuf operations.
+// the callback will be invoked with the number of bytes of the serialized
+// message once all its fragments will be sent.
+template <typename T>
+void async_send(const std::string& host, const std::string& port,
+                const T& message,
+                const std::function<void(std::size_t)>& callback = nullptr) {
+  auto& service = default_service();
+  std::string protobuf("");
+  // the pending operations keep the session alive.
+  auto session = network::Datagram::new_session(service);
+
+  try {
+    message.SerializeToString(&protobuf);
+    auto endpoint = resolve(service, host, port);
+    auto datagrams = fragment(protobuf);
+    auto remaining = std::make_shared<std::size_t>(datagrams.size());
+    auto size = protobuf.size();
+
+    session->set_write_handler(
+        [callback, remaining, size](std::size_t, network::Datagram&) {
+          if (not --*remaining and callback) callback(size);
+        });
+    session->open(endpoint.protocol());
+    for (const auto& datagram : datagrams)
+      session->async_send_to(datagram, endpoint);
+  } catch (std::exception& e) {
+    core::Error::print(e.what());
+  }
+}
+
+// synchronous receive of a protobuf message sent over UDP.
+// waits until all the fragments of a message have been received.
+template <typename T>
+T receive(const std::string& port) {
+  core::Service service;
+  std::string received("");
+  Reassembler reassembler;
+  auto session = network::Datagram::new_session(service);
+
+  try {
+    asio::ip::udp::endpoint sender;
+    session->bind(asio::ip::udp::endpoint(
+                      asio::ip::udp::v4(),
+                      static_cast<unsigned short>(std::stoi(port))),
+                  true);
+    while (not reassembler.feed(session->receive_from(sender), sender,
+                                received))
+      ;
+  } catch (std::exception& e) {
+    core::Error::print(e.what());
+  }
+
+  T result;
+  result.ParseFromString(received);
+  return result;
+}
+
+/**
+*   @brief: asynchronous receiver of protobuf messages sent over UDP.
+*
+*   @description: listens on the given port and invokes the callback with
+*   each message reassembled, until the receiver is stopped.
+*
+*/
+template <typename T>
+class Receiver {
+ public:
+  // Ctor
+  explicit Receiver(const std::string& port,
+                    const std::function<void(T)>& callback,
+                    std::size_t capacity = 64,
+                    const std::chrono::milliseconds& timeout =
+                        std::chrono::seconds(1))
+      : session_(network::Datagram::new_session(service_)),
+        reassembler_(capacity, timeout),
+        callback_(callback) {
+    session_->bind(asio::ip::udp::endpoint(
+                       asio::ip::udp::v4(),
+                       static_cast<unsigned short>(std::stoi(port))),
+                   true);
+    session_->set_read_handler([this](std::string datagram,
+                                      const asio::ip::udp::endpoint& sender,
+                                      network::Datagram& session) {
+      std::string protobuf;
+
+      // handlers are serialized by the strand, the table is never shared.
+      if (reassembler_.feed(datagram, sender, protobuf) and callback_) {
+        T result;
+        if (result.ParseFromString(protobuf)) callback_(result);
+      }
+      session.async_receive();
+    });
+    session_->service().run();
+    session_->async_receive();
+  }
+
+  // Copy Ctor
+  Receiver(const Receiver&) = delete;
+  // Assignment operator
+  Receiver& operator=(const Receiver&) = delete;
+
+  // Dtor
+  ~Receiver() noexcept { stop(); }
+
+  // stops the receiver.
+  void stop() {
+    auto session = session_;
+    // the socket is closed from the strand, where its operations are running.
+    service_.get_strand().post([session]() { session->close(); });
+    service_.stop();
+  }
+
+ private:
+  // I/O services.
+  core::Service service_;
+  // The socket bound to the given port.
+  network::Datagram::session session_;
+  // The incomplete messages.
+  Reassembler reassembler_;
+  // The callback invoked with each message received.
+  std::function<void(T)> callback_;
+};
+
+}  // namespace udp
+
 }  // namespace protobuf
 
 }  // namespace hermes
@@ -1,19 +1,34 @@
 #pragma once
 
+#include <map>
+#include <list>
 #include <mutex>
+#include <deque>
+#include <random>
 #include <atomic>
+#include <future>
 #include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
+#include <cstdint>
 #include <iostream>
+#include <algorithm>
 #include <stdexcept>
 #include <functional>
+#include <unordered_map>
 #include <condition_variable>
 
 #include "asio.hpp"
 
+// co_await-able operations are provided when the compiler supports the C++20
+// coroutines.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define HERMES_COROUTINES
+#endif
+
 namespace hermes {
 
 
@@ -69,6 +84,7 @@ class Service {
   Service()
       : strand_(io_service_),
         stop_(false),
+        stopping_(false),
         work_(new asio::io_context::work(io_service_)) {}
 
   // CopyCtor
@@ -83,10 +99,18 @@ class Service {
   }
 
   // runs the service in his dedicated thread.
+  // Can be called concurrently: the thread is started once. A stopped
+  // service is restarted (e.g: a client reconnected after disconnect()),
+  // unless it is still stopping.
   void run() {
-    if (not stop_)
-      if (not thread_.joinable())
-        thread_ = std::thread([this]() { io_service_.run(); });
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ or thread_.joinable()) return;
+    if (stop_) {
+      io_service_.restart();
+      work_.reset(new asio::io_context::work(io_service_));
+      stop_ = false;
+    }
+    thread_ = std::thread([this]() { io_service_.run(); });
   }
 
   // asks the I/O service to execute the given handler.
@@ -96,16 +120,26 @@ class Service {
 
   // stops the service.
   void stop() {
-    if (not stop_) {
+    std::thread thread;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_) return;
       stop_ = true;
+      stopping_ = true;
       work_.reset();
-      if (thread_.joinable())
-        thread_.join();
-      else {
-        io_service_.run();
-        io_service_.stop();
-      }
+      thread = std::move(thread_);
+    }
+
+    // joined without the lock, the pending handlers may call run().
+    if (thread.joinable())
+      thread.join();
+    else {
+      io_service_.run();
+      io_service_.stop();
     }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
   }
 
   // returns the state of the service.
@@ -124,9 +158,15 @@ class Service {
   // Dedicated thread to call the run() method.
   std::thread thread_;
 
+  // Protects the start and the stop of the thread.
+  std::mutex mutex_;
+
   // Indicates if the service is stopped.
   std::atomic<bool> stop_;
 
+  // Indicates if the service is stopping, it cannot be restarted meanwhile.
+  bool stopping_;
+
   // I/O services.
   asio::io_context io_service_;
 
@@ -141,6 +181,378 @@ class Service {
   std::unique_ptr<asio::io_context::work> work_;
 };
 
+/**
+*  @brief: Pool of I/O services.
+*
+*  @description: each Service runs its own thread. Instead of giving a
+*  dedicated Service to each connection, a ServicePool runs a handful of
+*  services and hands them out in a round-robin fashion, so that thousands of
+*  connections (e.g: tcp::Client constructed against a shared service) share
+*  a few event loop threads.
+*
+*  @code: c++
+*   hermes::core::ServicePool pool(4);
+*   hermes::tcp::Client client("127.0.0.1", "8080", pool.next());
+*  @endcode
+*
+*/
+class ServicePool {
+ public:
+  // Ctor
+  // runs the given number of services, at least one.
+  explicit ServicePool(
+      std::size_t size = std::max(1u, std::thread::hardware_concurrency()))
+      : next_(0) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(size, 1); ++i) {
+      services_.emplace_back(new Service);
+      services_.back()->run();
+    }
+  }
+
+  // CopyCtor
+  ServicePool(const ServicePool&) = delete;
+  // Assignment operator
+  ServicePool& operator=(const ServicePool&) = delete;
+
+  // Dtor
+  ~ServicePool() { stop(); }
+
+  // returns the next service, in a round-robin fashion.
+  Service& next() { return *services_[next_++ % services_.size()]; }
+
+  // stops all the services, waiting for their pending operations.
+  void stop() {
+    for (auto& service : services_) service->stop();
+  }
+
+  // returns the number of services.
+  std::size_t size() const { return services_.size(); }
+
+ private:
+  // The services.
+  std::vector<std::unique_ptr<Service>> services_;
+
+  // Index of the next service to hand out.
+  std::atomic<std::size_t> next_;
+};
+
+/**
+*  @brief: Exponential backoff with jitter.
+*
+*  @description: Backoff computes the delays between the retries of an
+*  operation (e.g: a reconnection). The ceiling of the delay doubles at each
+*  attempt, from initial to max, and the delay is drawn randomly between the
+*  half of the ceiling and the ceiling. The jitter spreads the retries of many
+*  clients disconnected at the same time, instead of hitting the restarting
+*  server in waves.
+*
+*/
+class Backoff {
+ public:
+  // Ctor
+  explicit Backoff(
+      const std::chrono::milliseconds& initial = std::chrono::milliseconds(100),
+      const std::chrono::milliseconds& max = std::chrono::seconds(30))
+      : initial_(std::max<std::chrono::milliseconds::rep>(initial.count(), 1)),
+        max_(std::max(initial_, max)),
+        attempts_(0),
+        random_(std::random_device{}()) {}
+
+  // returns the delay before the next attempt.
+  std::chrono::milliseconds next() {
+    auto ceiling = initial_;
+
+    for (std::size_t i = 0; i < attempts_ and ceiling < max_; ++i)
+      ceiling *= 2;
+    ceiling = std::min(ceiling, max_);
+    ++attempts_;
+
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(
+        ceiling.count() / 2, ceiling.count());
+    return std::chrono::milliseconds(jitter(random_));
+  }
+
+  // starts over from the initial delay, e.g: once the operation succeeded.
+  void reset() { attempts_ = 0; }
+
+  // returns the number of attempts since the last reset.
+  std::size_t attempts() const { return attempts_; }
+
+ private:
+  // The first ceiling.
+  std::chrono::milliseconds initial_;
+  // The maximum ceiling.
+  std::chrono::milliseconds max_;
+  // Number of attempts since the last reset.
+  std::size_t attempts_;
+  // Source of the jitter.
+  std::mt19937 random_;
+};
+
+/**
+*  @brief: Circuit breaker
+*
+*  @description: CircuitBreaker stops calling a server which is failing, so
+*  that the calls fail immediately instead of waiting for timeouts.
+*  The breaker is closed while the server works. It opens once the ratio of
+*  failed calls (errors and calls slower than the slow threshold) over the
+*  last calls reaches the failure ratio: the calls are then refused. After
+*  the open duration, the breaker is half-open and lets a probe call through:
+*  the breaker closes if the probe succeeds, or opens again otherwise.
+*  CircuitBreaker::of returns the breaker of an endpoint, shared by the
+*  clients of this endpoint.
+*
+*/
+class CircuitBreaker {
+ public:
+  enum State { CLOSED, OPEN, HALF_OPEN };
+
+  // Ctor
+  //
+  //  @param:
+  //    - ratio, of failed calls opening the breaker.
+  //    - window, the number of last calls considered, the breaker does not
+  //      open before window calls have been made.
+  //    - open, the duration during which the calls are refused.
+  //    - slow, the latency above which a call is failed, zero to disable.
+  explicit CircuitBreaker(
+      double ratio = 0.5, std::size_t window = 20,
+      const std::chrono::milliseconds& open = std::chrono::seconds(5),
+      const std::chrono::milliseconds& slow = std::chrono::milliseconds(0))
+      : ratio_(ratio),
+        window_(std::max<std::size_t>(window, 1)),
+        open_(open),
+        slow_(slow),
+        state_(CLOSED),
+        failures_(0),
+        probing_(false) {}
+
+  // returns the breaker of the given endpoint (e.g: "host:port"), shared by
+  // all its clients. It is created with the default settings.
+  static std::shared_ptr<CircuitBreaker> of(const std::string& endpoint) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<CircuitBreaker>> breakers;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& breaker = breakers[endpoint];
+    if (not breaker) breaker = std::make_shared<CircuitBreaker>();
+    return breaker;
+  }
+
+  // returns true whether the call can be made. Once the open duration is
+  // over, a single probe call is allowed until its outcome is known.
+  bool allow() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == OPEN and std::chrono::steady_clock::now() >= until_)
+      state_ = HALF_OPEN;
+    if (state_ == CLOSED) return true;
+    if (state_ == OPEN or probing_) return false;
+    probing_ = true;
+    return true;
+  }
+
+  // records a successful call and its latency.
+  void success(const std::chrono::steady_clock::duration& latency =
+                   std::chrono::steady_clock::duration::zero()) {
+    if (slow_.count() and latency > slow_) return failure();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == HALF_OPEN) {
+      reset(CLOSED);
+      return;
+    }
+    record(false);
+  }
+
+  // records a failed call.
+  void failure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == HALF_OPEN) {
+      trip();
+      return;
+    }
+    record(true);
+    if (calls_.size() == window_ and failures_ >= ratio_ * window_) trip();
+  }
+
+  // returns the state of the breaker.
+  State state() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == OPEN and std::chrono::steady_clock::now() >= until_)
+      return HALF_OPEN;
+    return state_;
+  }
+
+ private:
+  // records the outcome of a call in the window. mutex_ must be locked.
+  void record(bool failed) {
+    calls_.push_back(failed);
+    failures_ += failed;
+    if (calls_.size() > window_) {
+      failures_ -= calls_.front();
+      calls_.pop_front();
+    }
+  }
+
+  // opens the breaker. mutex_ must be locked.
+  void trip() {
+    reset(OPEN);
+    until_ = std::chrono::steady_clock::now() + open_;
+  }
+
+  // changes the state and forgets the calls. mutex_ must be locked.
+  void reset(State state) {
+    state_ = state;
+    probing_ = false;
+    failures_ = 0;
+    calls_.clear();
+  }
+
+  // Ratio of failed calls opening the breaker.
+  double ratio_;
+  // Number of calls considered.
+  std::size_t window_;
+  // Duration during which the calls are refused.
+  std::chrono::milliseconds open_;
+  // Latency above which a call is failed.
+  std::chrono::milliseconds slow_;
+  // Protects the state.
+  std::mutex mutex_;
+  // The state of the breaker.
+  State state_;
+  // The outcome of the last calls, true if failed.
+  std::deque<bool> calls_;
+  // Number of failed calls in the window.
+  std::size_t failures_;
+  // Indicates if the probe call is in progress.
+  bool probing_;
+  // The end of the open duration.
+  std::chrono::steady_clock::time_point until_;
+};
+
+/**
+*  @brief: Bounded cache of responses
+*
+*  @description: Cache keeps the last responses by key (a request payload or
+*  a key chosen by the user), so that an idempotent request already answered
+*  does not reach the network. It holds at most capacity entries, the least
+*  recently used one is evicted first, and an entry expires after the time to
+*  live. The hits and misses are counted to tune its size.
+*  It is thread safe.
+*
+*/
+class Cache {
+ public:
+  // Ctor
+  explicit Cache(std::size_t capacity = 1024,
+                 const std::chrono::milliseconds& ttl = std::chrono::seconds(60))
+      : capacity_(std::max<std::size_t>(capacity, 1)),
+        ttl_(ttl),
+        hits_(0),
+        misses_(0) {}
+
+  // Copy Ctor
+  Cache(const Cache&) = delete;
+  // Assignment operator
+  Cache& operator=(const Cache&) = delete;
+
+  // returns true and sets value whether a live entry is cached for the key.
+  bool get(const std::string& key, std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it == index_.end() or
+        it->second->expiry <= std::chrono::steady_clock::now()) {
+      if (it != index_.end()) erase(it);
+      ++misses_;
+      return false;
+    }
+    // most recently used first.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    value = it->second->value;
+    ++hits_;
+    return true;
+  }
+
+  // caches the value of the key, evicting the least recently used entry if
+  // the cache is full.
+  void put(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) erase(it);
+    if (index_.size() >= capacity_) erase(index_.find(entries_.back().key));
+
+    entries_.push_front(
+        Entry{key, value, std::chrono::steady_clock::now() + ttl_});
+    index_[key] = entries_.begin();
+  }
+
+  // removes the entry of the key, if any.
+  void invalidate(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) erase(it);
+  }
+
+  // removes all the entries.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    entries_.clear();
+  }
+
+  // returns the number of entries, expired ones included.
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+  }
+
+  // returns the number of lookups answered from the cache.
+  std::size_t hits() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+  }
+
+  // returns the number of lookups not answered from the cache.
+  std::size_t misses() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  typedef std::unordered_map<std::string, std::list<Entry>::iterator> Index;
+
+  void erase(Index::iterator it) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  // Maximum number of entries.
+  std::size_t capacity_;
+  // Time to live of the entries.
+  std::chrono::milliseconds ttl_;
+  // Protects the entries and the counters.
+  std::mutex mutex_;
+  // The entries, most recently used first.
+  std::list<Entry> entries_;
+  // The entries by key.
+  Index index_;
+  // Number of lookups answered.
+  std::size_t hits_;
+  // Number of lookups not answered.
+  std::size_t misses_;
+};
 
 /**
 *  @brief: Errors handling class
@@ -242,6 +654,126 @@ class Error {
   asio::error_code error_;
 };
 
+// completes the promise of a future-returning operation, from the I/O thread,
+// with the value or with the error as an asio::system_error exception.
+template <typename T>
+void complete(std::promise<T>& promise, const asio::error_code& error,
+              T value) {
+  if (error)
+    promise.set_exception(std::make_exception_ptr(asio::system_error(error)));
+  else
+    promise.set_value(std::move(value));
+}
+
+#ifdef HERMES_COROUTINES
+
+/**
+*  @brief: C++20 coroutines support
+*
+*  @description: Awaitable turns an asynchronous asio operation into an object
+*  which can be co_await-ed. The operation is started when the coroutine is
+*  suspended, and the coroutine is resumed from the I/O thread, by the
+*  completion handler, with the result of the operation. No thread is parked
+*  waiting for the operation, and the request/response logic can be written
+*  as straight-line code.
+*  An error is thrown as an asio::system_error from the co_await expression.
+*
+*  Task is a detached coroutine type, to run such a straight-line code:
+*
+*  @code: c++
+*   hermes::core::Task ping(hermes::tcp::Client& client) {
+*     co_await client.co_connect();
+*     co_await client.co_send("ping");
+*     std::string pong = co_await client.co_receive();
+*   }
+*  @endcode
+*
+*/
+template <typename Result, typename Initiation>
+class Awaitable {
+ public:
+  explicit Awaitable(Initiation initiation)
+      : initiation_(std::move(initiation)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // the coroutine may be resumed, and this object destroyed, before the
+    // initiation returns. Nothing of this object is used past this point.
+    auto initiation = std::move(initiation_);
+    initiation([this, handle](const asio::error_code& error, Result result) {
+      error_ = error;
+      result_ = std::move(result);
+      handle.resume();
+    });
+  }
+
+  Result await_resume() {
+    if (error_) throw asio::system_error(error_);
+    return std::move(result_);
+  }
+
+ private:
+  Initiation initiation_;
+  asio::error_code error_;
+  Result result_;
+};
+
+// Awaitable of an operation without result (e.g: connect).
+template <typename Initiation>
+class Awaitable<void, Initiation> {
+ public:
+  explicit Awaitable(Initiation initiation)
+      : initiation_(std::move(initiation)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto initiation = std::move(initiation_);
+    initiation([this, handle](const asio::error_code& error) {
+      error_ = error;
+      handle.resume();
+    });
+  }
+
+  void await_resume() {
+    if (error_) throw asio::system_error(error_);
+  }
+
+ private:
+  Initiation initiation_;
+  asio::error_code error_;
+};
+
+// builds an Awaitable from the function starting the asynchronous operation.
+// the function receives the completion handler to invoke with the result.
+template <typename Result, typename Initiation>
+Awaitable<Result, Initiation> make_awaitable(Initiation initiation) {
+  return Awaitable<Result, Initiation>(std::move(initiation));
+}
+
+// Detached coroutine. It starts immediately and its frame is released once
+// it is completed. An exception escaping the coroutine is printed.
+struct Task {
+  struct promise_type {
+    Task get_return_object() noexcept { return Task(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() {
+      try {
+        throw;
+      } catch (std::exception& e) {
+        Error::print(e.what());
+      } catch (...) {
+        Error::print("Unexpected error occurred in a coroutine.");
+      }
+    }
+  };
+};
+
+#endif  // HERMES_COROUTINES
+
 }  // namespace core
 
 
@@ -262,6 +794,306 @@ class Error {
 */
 namespace network {
 
+/**
+*   @brief: Asynchronous name resolution with a cache.
+*
+*   @description: Resolver resolves host:port asynchronously, on its own I/O
+*   thread, and caches the endpoints so that the connections do not wait for
+*   the DNS on each call. The concurrent resolutions of a same host:port are
+*   coalesced into one.
+*   getaddrinfo does not expose the TTL of the DNS records, so the entries
+*   expire after a configurable time to live (60 seconds by default), to be
+*   set according to the TTL of your records. The expired entries are
+*   evicted once per time to live.
+*   The callbacks are always invoked from the I/O thread of the resolver,
+*   even when the endpoints are cached.
+*   Resolver::shared() is the resolver used by the tcp clients.
+*
+*/
+class Resolver {
+ public:
+  typedef std::vector<asio::ip::tcp::endpoint> endpoints;
+
+  // invoked with the endpoints of the host, or with the error of the
+  // resolution.
+  typedef std::function<void(const asio::error_code&, const endpoints&)>
+      callback;
+
+  // Ctor
+  explicit Resolver(
+      const std::chrono::milliseconds& ttl = std::chrono::seconds(60))
+      : ttl_(ttl),
+        next_prune_(std::chrono::steady_clock::now() + ttl),
+        resolver_(service_.get()) {
+    service_.run();
+  }
+
+  // Copy Ctor
+  Resolver(const Resolver&) = delete;
+  // Assignment operator
+  Resolver& operator=(const Resolver&) = delete;
+
+  // Dtor
+  ~Resolver() noexcept {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      resolver_.cancel();
+    }
+    service_.stop();
+  }
+
+  // returns the resolver shared by the clients.
+  static Resolver& shared() {
+    static Resolver resolver;
+    return resolver;
+  }
+
+  // asynchronous resolution of host:port.
+  // the callback is invoked from the I/O thread of the resolver, right away
+  // if the endpoints are cached, otherwise once resolved. Never from the
+  // calling thread, so it can take the locks held by the caller.
+  void async_resolve(const std::string& host, const std::string& port,
+                     const callback& callback) {
+    auto key = host + ":" + port;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    prune();
+    auto& entry = cache_[key];
+
+    if (fresh(entry)) {
+      auto endpoints = entry.list;
+      service_.post([callback, endpoints]() {
+        callback(asio::error_code(), endpoints);
+      });
+      return;
+    }
+
+    // a resolution of host:port is already in progress.
+    entry.waiting.push_back(callback);
+    if (entry.waiting.size() > 1) return;
+
+    resolver_.async_resolve(
+        host, port, [this, key](const asio::error_code& error,
+                                asio::ip::tcp::resolver::results_type results) {
+          resolved(key, error, endpoints(results.begin(), results.end()));
+        });
+  }
+
+  // synchronous resolution of host:port, only waits on a cache miss.
+  // throws asio::system_error if the resolution fails.
+  endpoints resolve(const std::string& host, const std::string& port) {
+    auto key = host + ":" + port;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = cache_.find(key);
+      if (found != cache_.end() and fresh(found->second))
+        return found->second.list;
+    }
+
+    // from a callback, the I/O thread would wait for itself: resolves on
+    // the calling thread instead.
+    if (service_.get().get_executor().running_in_this_thread()) {
+      asio::ip::tcp::resolver resolver(service_.get());
+      auto results = resolver.resolve(host, port);
+      endpoints list(results.begin(), results.end());
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& entry = cache_[key];
+      entry.list = list;
+      entry.expiry = std::chrono::steady_clock::now() + ttl_;
+      return list;
+    }
+
+    std::promise<endpoints> promise;
+
+    async_resolve(host, port, [&promise](const asio::error_code& error,
+                                         const endpoints& endpoints) {
+      core::complete(promise, error, endpoints);
+    });
+    return promise.get_future().get();
+  }
+
+  // sets the time to live of the entries resolved from now on.
+  void set_ttl(const std::chrono::milliseconds& ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = ttl;
+  }
+
+  // drops the cached entries, e.g: after a failover of the servers.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.waiting.empty())
+        it = cache_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+ private:
+  // The endpoints of a host:port.
+  struct Entry {
+    endpoints list;
+    std::chrono::steady_clock::time_point expiry;
+    // The callbacks waiting for the resolution in progress.
+    std::vector<callback> waiting;
+  };
+
+  // returns true whether the endpoints of the entry are cached and not
+  // expired.
+  static bool fresh(const Entry& entry) {
+    return not entry.list.empty() and
+           std::chrono::steady_clock::now() < entry.expiry;
+  }
+
+  // evicts the entries expired (or failed) without resolution in progress,
+  // at most once per time to live. mutex_ must be locked.
+  void prune() {
+    auto now = std::chrono::steady_clock::now();
+
+    if (now < next_prune_) return;
+    next_prune_ = now + ttl_;
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.waiting.empty() and not fresh(it->second))
+        it = cache_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  // caches the endpoints and completes the waiting callbacks.
+  // Runs in the I/O thread of the resolver.
+  void resolved(const std::string& key, const asio::error_code& error,
+                const endpoints& endpoints) {
+    std::vector<callback> waiting;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& entry = cache_[key];
+
+      waiting.swap(entry.waiting);
+      if (not error) {
+        entry.list = endpoints;
+        entry.expiry = std::chrono::steady_clock::now() + ttl_;
+      }
+    }
+    for (auto& callback : waiting) callback(error, endpoints);
+  }
+
+  // The time to live of the entries.
+  std::chrono::milliseconds ttl_;
+  // Time of the next eviction of the expired entries.
+  std::chrono::steady_clock::time_point next_prune_;
+  // I/O services, runs the resolutions.
+  core::Service service_;
+  // Protects the cache and the asio resolver.
+  std::mutex mutex_;
+  // The entries, by host:port.
+  std::unordered_map<std::string, Entry> cache_;
+  // The asio resolver.
+  asio::ip::tcp::resolver resolver_;
+};
+
+// integer option of the TCP level, for the options asio does not provide
+// (e.g: TCP_FASTOPEN). Passed to set_option, as the options of asio.
+template <int Name>
+class tcp_option {
+ public:
+  // Ctor
+  explicit tcp_option(int value) : value_(value) {}
+
+  template <typename Protocol>
+  int level(const Protocol&) const {
+    return IPPROTO_TCP;
+  }
+
+  template <typename Protocol>
+  int name(const Protocol&) const {
+    return Name;
+  }
+
+  template <typename Protocol>
+  const int* data(const Protocol&) const {
+    return &value_;
+  }
+
+  template <typename Protocol>
+  std::size_t size(const Protocol&) const {
+    return sizeof(value_);
+  }
+
+ private:
+  // The value of the option.
+  int value_;
+};
+
+/**
+*   @brief: Options of the TCP sockets
+*
+*   @description: SocketOptions gathers the tuning of a connection, applied
+*   by Stream before its connection, and by tcp::Server to every session it
+*   accepts. The options left to their default value are not set, and the
+*   options not supported by the system are ignored.
+*
+*   @code: c++
+*    hermes::network::SocketOptions latency;
+*    latency.no_delay = true;
+*    latency.quick_ack = true;
+*
+*    server.set_options(latency);
+*    client.set_options(latency);
+*  @endcode
+*
+*/
+struct SocketOptions {
+  // disables the Nagle algorithm (TCP_NODELAY): the small messages are sent
+  // immediately instead of being coalesced.
+  bool no_delay = false;
+  // size of the kernel send buffer (SO_SNDBUF) in bytes, 0 for the default.
+  int send_buffer = 0;
+  // size of the kernel receive buffer (SO_RCVBUF) in bytes, 0 for the
+  // default. Set before the connection, it allows a larger window.
+  int receive_buffer = 0;
+  // acknowledges the data immediately instead of delaying the ACK
+  // (TCP_QUICKACK). The kernel can leave this mode, it is set at the
+  // connection only. Linux only.
+  bool quick_ack = false;
+  // probes the idle connections to detect a dead peer (SO_KEEPALIVE).
+  bool keep_alive = false;
+  // the connection is dropped once the data sent stay unacknowledged for
+  // this duration (TCP_USER_TIMEOUT), 0 for the default. Linux only.
+  std::chrono::milliseconds user_timeout = std::chrono::milliseconds(0);
+  // sends the data of the first send with the SYN (TCP_FASTOPEN_CONNECT),
+  // cf: Stream::set_fast_open. Client side only.
+  bool fast_open = false;
+
+  // sets the options on the socket, the errors are ignored.
+  template <typename Socket>
+  void apply(Socket& socket) const {
+    core::Error ignored;
+
+    if (no_delay)
+      socket.set_option(asio::ip::tcp::no_delay(true), ignored.get());
+    if (send_buffer)
+      socket.set_option(asio::socket_base::send_buffer_size(send_buffer),
+                        ignored.get());
+    if (receive_buffer)
+      socket.set_option(asio::socket_base::receive_buffer_size(receive_buffer),
+                        ignored.get());
+    if (keep_alive)
+      socket.set_option(asio::socket_base::keep_alive(true), ignored.get());
+#ifdef TCP_QUICKACK
+    if (quick_ack) socket.set_option(tcp_option<TCP_QUICKACK>(1), ignored.get());
+#endif
+#ifdef TCP_USER_TIMEOUT
+    if (user_timeout.count())
+      socket.set_option(
+          tcp_option<TCP_USER_TIMEOUT>(static_cast<int>(user_timeout.count())),
+          ignored.get());
+#endif
+  }
+};
+
 /**
 *   @brief: an asio::tcp::ip::socket wrapper to manage and serialize operations
 *   on the socket.
@@ -290,6 +1122,7 @@ class Stream : public std::enable_shared_from_this<Stream> {
   void connect(const asio::ip::tcp::endpoint& endpoint) {
     core::Error error;
 
+    prepare(socket_, endpoint);
     socket_.connect(endpoint, error.get());
     if (error.exist()) error.throw_it();
     connected_ = true;
@@ -298,6 +1131,9 @@ class Stream : public std::enable_shared_from_this<Stream> {
   // asynchronous connection to the given endpoint
   // a callback can be provided, it will be executed once the connection
   // established.
+  // async_connect returns immediately, the completion is only reported through
+  // the callback, or through the error handler if the connection failed. Many
+  // connections can thus be opened concurrently.
   //
   // @param:
   //    - endpoint
@@ -317,38 +1153,129 @@ class Stream : public std::enable_shared_from_this<Stream> {
   // @endcode
   void async_connect(const asio::ip::tcp::endpoint& endpoint,
                      const std::function<void(Stream&)>& callback = nullptr) {
-    if (connected_) return;
-
-    std::condition_variable condvar;
-    std::atomic_bool notified(false);
+    if (connected_ or connecting_) return;
 
-    socket_.async_connect(endpoint, [&](const asio::error_code& error) {
-
-      if (error) throw asio::system_error(error);
-      connected_ = true;
-      if (callback) callback(*this);
-      notified = true;
-      // notify that the connection has succeeded
-      condvar.notify_one();
+    async_connect(endpoint, [this, callback](const asio::error_code& error) {
+      if (error)
+        report(error);
+      else if (callback)
+        callback(*this);
     });
+  }
 
-    std::mutex mutex;
-    std::unique_lock<std::mutex> lock(mutex);
+  // asynchronous connection to the given endpoint, the completion receives
+  // the result of the operation instead of the error handler. It is invoked
+  // from the I/O thread, with already_started if the stream is connected or
+  // connecting. A closed stream can be connected again.
+  void async_connect(
+      const asio::ip::tcp::endpoint& endpoint,
+      const std::function<void(const asio::error_code&)>& completion) {
     service_.run();
-    if (not notified) condvar.wait(lock);
+    if (connected_ or connecting_.exchange(true)) {
+      service_.get_strand().post(
+          [completion]() { completion(asio::error::already_started); });
+      return;
+    }
+
+    auto roxanne(shared_from_this());
+
+    prepare(socket_, endpoint);
+    socket_.async_connect(
+        endpoint, service_.get_strand().wrap([this, roxanne, completion](
+                      const asio::error_code& error) {
+          connecting_ = false;
+
+          if (not error) {
+            connected_ = true;
+            closing_ = false;
+          }
+          completion(error);
+        }));
   }
 
-  // Stops the stream.
-  // @Note: does not stop the service.
-  void disconnect() {
-    if (not connected_) return;
+  // asynchronous connection to the first of the endpoints accepting it
+  // (happy eyeballs, RFC 8305).
+  // The IPv6 and IPv4 endpoints are interleaved, and the attempts are
+  // staggered: a new attempt starts every delay, or as soon as the previous
+  // one failed, without cancelling the attempts in progress. The first
+  // connection established wins and the other attempts are cancelled. Thus a
+  // slow or unreachable address only delays the connection by the delay.
+  // The completion is invoked from the I/O thread, with the error of the last
+  // attempt if all of them failed.
+  void async_connect(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints,
+      const std::function<void(const asio::error_code&)>& completion,
+      const std::chrono::milliseconds& delay = std::chrono::milliseconds(250)) {
+    service_.run();
+    if (endpoints.empty() or connected_ or connecting_.exchange(true)) {
+      asio::error_code error = asio::error::already_started;
+      if (endpoints.empty()) error = asio::error::host_not_found;
+      service_.get_strand().post([completion, error]() { completion(error); });
+      return;
+    }
 
-    connected_ = false;
+    auto roxanne(shared_from_this());
+    auto race = std::make_shared<Race>(service_.get(), interleave(endpoints));
 
-    // To prevent some concurrency issues, the shutdown and close calls
-    // are locked, waiting to be notified that one thread has completed the
-    // tasks.
-    // First thread to come up here, changes the boolean to false and runs the
+    service_.get_strand().post([this, roxanne, race, completion, delay]() {
+      attempt(race, completion, delay);
+    });
+  }
+
+  // asynchronous connection to the first of the endpoints accepting it, a
+  // failure is reported to the error handler.
+  void async_connect(const std::vector<asio::ip::tcp::endpoint>& endpoints,
+                     const std::function<void(Stream&)>& callback = nullptr) {
+    async_connect(endpoints, [this, callback](const asio::error_code& error) {
+      if (error)
+        report(error);
+      else if (callback)
+        callback(*this);
+    });
+  }
+
+  // synchronous connection to the first of the endpoints accepting it, cf:
+  // async_connect. From an I/O thread of the stream (e.g: a handler), which
+  // cannot wait for the race, or when the service cannot run (e.g: still
+  // stopping), the endpoints are tried one after the other without delay.
+  void connect(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints,
+      const std::chrono::milliseconds& delay = std::chrono::milliseconds(250)) {
+    std::promise<asio::error_code> promise;
+    core::Error error;
+
+    service_.run();
+    if (service_.is_stop() or
+        service_.get().get_executor().running_in_this_thread()) {
+      connect_sequentially(endpoints);
+      return;
+    }
+
+    async_connect(endpoints, [&promise](const asio::error_code& error) {
+      promise.set_value(error);
+    }, delay);
+    error.get() = promise.get_future().get();
+    if (error.exist()) error.throw_it();
+  }
+
+  // Stops the stream.
+  // @Note: does not stop the service.
+  void disconnect() {
+    if (not connected_) return;
+
+    connected_ = false;
+
+    // called from an handler running in the strand (e.g: a read handler),
+    // waiting for the strand to close the socket would never end.
+    if (service_.get_strand().running_in_this_thread()) {
+      close();
+      return;
+    }
+
+    // To prevent some concurrency issues, the shutdown and close calls
+    // are locked, waiting to be notified that one thread has completed the
+    // tasks.
+    // First thread to come up here, changes the boolean to false and runs the
     // function object to close/shutdown the socket and he notifies that the job
     // is completed. Once that is done, next thread to come up here will have
     // the boolean connected_ set with false as value and the function will
@@ -358,15 +1285,39 @@ class Stream : public std::enable_shared_from_this<Stream> {
     std::unique_lock<std::mutex> lock(mutex);
 
     std::atomic_bool notified(false);
-    service_.get_strand().post([this, &condvar, &notified]() {
-      core::Error error;
-      // asio error_code provided to ensure that no exception will be thrown.
-      socket_.shutdown(asio::ip::tcp::socket::shutdown_both);
-      socket_.close(error.get());
+    service_.get_strand().post([this, &mutex, &condvar, &notified]() {
+      close();
+      std::lock_guard<std::mutex> guard(mutex);
       notified = true;
       condvar.notify_one();
     });
-    if (not notified) condvar.wait(lock);
+    condvar.wait(lock, [&notified]() { return notified.load(); });
+  }
+
+  // Asynchronous and graceful close of the stream.
+  // The messages waiting in the write queue are sent first, then the sending
+  // side of the connection is shut down (half-close, the peer receives
+  // end-of-file). The input is read and discarded until the peer closes the
+  // connection too, or until the close timeout, then the socket is closed.
+  // The messages sent once the close started are dropped, cf: async_send.
+  // async_disconnect returns immediately, the callback is invoked from the
+  // I/O thread once the stream is closed. It can safely be called from any
+  // handler of the stream.
+  // @Note: does not stop the service.
+  void async_disconnect(const std::function<void(Stream&)>& callback = nullptr) {
+    auto roxanne(shared_from_this());
+
+    service_.get_strand().post([this, roxanne, callback]() {
+      if (closing_ or not socket_.is_open()) {
+        if (callback) callback(*this);
+        return;
+      }
+
+      connected_ = false;
+      closing_ = true;
+      close_handler_ = callback;
+      if (not writing_) graceful_close();
+    });
   }
 
   // Synchronous send of amount of data.
@@ -389,11 +1340,109 @@ class Stream : public std::enable_shared_from_this<Stream> {
   }
 
   // asynchronous send of amount of data
-  // Asks to strand to execute an asynchronous write on the socket.
+  // Asks to strand to queue the message. The messages are written one after
+  // the other, in the order of the calls.
+  // A message sent while the stream is closing or closed is dropped: the
+  // write handler is not invoked, the completion (cf: below) receives
+  // operation_aborted.
   void async_send(const std::string& message) {
-    // strand serializes the given handler
-    service_.get_strand().post(
-        std::bind(&Stream::async_send_handler, shared_from_this(), message));
+    async_send(message, nullptr);
+  }
+
+  // same as above, the completion is invoked from the I/O thread with the
+  // result of this send only, instead of the write handler.
+  //
+  // When no write is queued or in progress, the message is written
+  // immediately from the calling thread, as much as the socket buffer takes
+  // without blocking, saving the hops through the strand. Only the remainder,
+  // if any, is queued. The completion is still invoked from the I/O thread.
+  void async_send(
+      const std::string& message,
+      const std::function<void(const asio::error_code&, std::size_t)>&
+          completion) {
+    auto roxanne(shared_from_this());
+    std::size_t sent = 0;
+
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+
+      // held until flush.
+      if (batching_) {
+        batch_.push_back(Write{message, completion, 0});
+        return;
+      }
+
+      if (pending_writes_ == 0 and not closing_ and socket_.is_open())
+        sent = write_inline(message);
+
+      if (not message.empty() and sent == message.size()) {
+        if (completion or write_handler_)
+          service_.get_strand().post([this, roxanne, completion, sent]() {
+            if (completion)
+              completion(asio::error_code(), sent);
+            else if (write_handler_)
+              write_handler_(sent, *this);
+          });
+        return;
+      }
+
+      // strand serializes the given handler
+      ++pending_writes_;
+      service_.get_strand().post(std::bind(&Stream::async_send_handler,
+                                           roxanne, message.substr(sent),
+                                           completion, sent));
+    }
+  }
+
+  // starts a batch: the messages of the following asynchronous sends are held
+  // until flush, then written together, so that a logical message made of
+  // many pieces (e.g: a header and its body parts) leaves in full-sized
+  // segments instead of one small segment per piece. Where TCP_CORK is
+  // supported, the socket is also corked until the batch is written, which
+  // coalesces the synchronous sends of the batch as well, including when the
+  // batch starts before the connection.
+  // Closing the socket ends the batch: its messages are dropped and their
+  // completions receive operation_aborted.
+  // NOTE: the messages of a batch are only sent by flush.
+  void begin_batch() {
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+
+    if (batching_) return;
+    batching_ = true;
+    if (socket_.is_open()) cork(true);
+  }
+
+  // ends the batch: the messages held are written with a single write, then
+  // the socket is uncorked. Returns immediately, the completions are invoked
+  // from the I/O thread.
+  void flush() {
+    auto roxanne(shared_from_this());
+    auto batch = std::make_shared<std::vector<Write>>();
+
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+    if (not batching_) return;
+    batching_ = false;
+    batch->swap(batch_);
+    pending_writes_ += batch->size();
+
+    service_.get_strand().post([this, roxanne, batch]() {
+      if (closing_ or not socket_.is_open()) {
+        for (auto& write : *batch) {
+          --pending_writes_;
+          if (write.completion)
+            write.completion(asio::error::operation_aborted, 0);
+        }
+        return;
+      }
+
+      uncork_ = true;
+      for (auto& write : *batch) write_queue_.push_back(std::move(write));
+      if (writing_) return;
+      if (write_queue_.empty())
+        uncork();
+      else
+        write_next();
+    });
   }
 
   // Synchronous receive.
@@ -418,10 +1467,16 @@ class Stream : public std::enable_shared_from_this<Stream> {
 
   // asynchronous receive of data
   // Asks to strand to execute an asynchronous read on the socket.
-  void async_receive() {
+  void async_receive() { async_receive(nullptr); }
+
+  // same as above, the completion is invoked from the I/O thread with the
+  // result of this receive only, instead of the read handler.
+  void async_receive(
+      const std::function<void(const asio::error_code&, std::string)>&
+          completion) {
     // strand serializes the given handler
-    service_.get_strand().post(
-        std::bind(&Stream::async_receive_handler, shared_from_this()));
+    service_.get_strand().post(std::bind(&Stream::async_receive_handler,
+                                         shared_from_this(), completion));
   }
 
   // sets the callback wich will be invoked by the asynchronous send.
@@ -436,9 +1491,113 @@ class Stream : public std::enable_shared_from_this<Stream> {
     read_handler_ = callback;
   }
 
+  // sets the callback wich will be invoked when an asynchronous operation
+  // fails. Without error handler, the error is printed.
+  void set_error_handler(
+      const std::function<void(const asio::error_code&, Stream&)>& callback) {
+    error_handler_ = callback;
+  }
+
+#ifdef HERMES_COROUTINES
+  // co_await-able connection to the given endpoint.
+  //
+  // @code: c++
+  //  co_await session->co_connect(endpoint);
+  // @endcode
+  auto co_connect(const asio::ip::tcp::endpoint& endpoint) {
+    auto roxanne(shared_from_this());
+
+    return core::make_awaitable<void>([this, roxanne, endpoint](auto done) {
+      prepare(socket_, endpoint);
+      socket_.async_connect(
+          endpoint, service_.get_strand().wrap(
+                        [this, roxanne, done](const asio::error_code& error) {
+                          if (not error) connected_ = true;
+                          done(error);
+                        }));
+    });
+  }
+
+  // co_await-able send, returns the number of bytes sent.
+  auto co_send(const std::string& message) {
+    auto roxanne(shared_from_this());
+    auto data = std::make_shared<std::string>(message);
+
+    return core::make_awaitable<std::size_t>([this, roxanne, data](auto done) {
+      asio::async_write(socket_, asio::buffer(*data),
+                        service_.get_strand().wrap(
+                            [roxanne, data, done](const asio::error_code& error,
+                                                  std::size_t bytes) {
+                              done(error, bytes);
+                            }));
+    });
+  }
+
+  // co_await-able receive, returns the data received.
+  // @Note: shares the buffer of async_receive, do not mix them concurrently.
+  auto co_receive() {
+    auto roxanne(shared_from_this());
+
+    return core::make_awaitable<std::string>([this, roxanne](auto done) {
+      socket_.async_read_some(
+          asio::buffer(buffer_, core::BUFFER_SIZE),
+          service_.get_strand().wrap([this, roxanne, done](
+              const asio::error_code& error, std::size_t bytes) {
+            done(error, std::string(buffer_, bytes));
+          }));
+    });
+  }
+#endif  // HERMES_COROUTINES
+
   // returns if the stream is connected.
   bool is_connected() { return connected_; }
 
+  // returns false whether the peer has closed the connection or the socket is
+  // in error. The data waiting to be read are not consumed.
+  // @Note: must not be called while an operation is running on the socket.
+  bool is_alive() {
+    if (not connected_ or not socket_.is_open()) return false;
+
+    core::Error error;
+    char byte;
+
+    socket_.non_blocking(true, error.get());
+    auto bytes = socket_.receive(asio::buffer(&byte, 1),
+                                 asio::socket_base::message_peek, error.get());
+    socket_.non_blocking(false);
+
+    if (error.get() == asio::error::would_block) return true;
+    return not error.exist() and bytes;
+  }
+
+  // enables TCP Fast Open on the connections made afterwards: the data of the
+  // first send leave with the SYN, saving a round trip, once the client got a
+  // cookie from the server (i.e: from the second connection to the server).
+  // The connection is then established without waiting for the server, and a
+  // connection failure is reported by the first send.
+  // The SYN data can be delivered twice to the server (RFC 7413, section 6):
+  // only enable it for idempotent first messages.
+  // Not used by a connection racing several endpoints, whose attempts would
+  // all succeed at once. Ignored where TCP_FASTOPEN_CONNECT is not supported
+  // (Linux >= 4.11).
+  void set_fast_open(bool enable) { options_.fast_open = enable; }
+
+  // sets the options of the socket, applied before the next connections.
+  // A connected (or accepted) socket gets them immediately, except fast_open.
+  void set_options(const SocketOptions& options) {
+    options_ = options;
+    if (socket_.is_open()) options_.apply(socket_);
+  }
+
+  // returns the options of the socket.
+  const SocketOptions& options() const { return options_; }
+
+  // sets the time given to the peer to close the connection after a
+  // graceful close (cf: async_disconnect), 1 second by default.
+  void set_close_timeout(const std::chrono::milliseconds& timeout) {
+    close_timeout_ = timeout;
+  }
+
   // returns the reference on the service used by the session.
   core::Service& service() { return service_; }
 
@@ -450,68 +1609,481 @@ class Stream : public std::enable_shared_from_this<Stream> {
   Stream(core::Service& service)
       : service_(service),
         connected_(false),
+        connecting_(false),
+        writing_(false),
+        closing_(false),
+        pending_writes_(0),
+        batching_(false),
+        uncork_(false),
+        close_handler_(nullptr),
+        close_timeout_(std::chrono::seconds(1)),
         socket_(service.get()),
         read_handler_(nullptr),
-        write_handler_(nullptr) {
+        write_handler_(nullptr),
+        error_handler_(nullptr) {
     std::memset(buffer_, 0, core::BUFFER_SIZE);
   }
 
-  // Performs the asio::async_write operation.
+  // reports the error of an asynchronous operation.
+  void report(const asio::error_code& error) {
+    if (error_handler_)
+      error_handler_(error, *this);
+    else
+      core::Error::print(error.message());
+  }
+
+  // A graceful close waiting for the end-of-file of the peer.
+  struct Linger {
+    explicit Linger(asio::io_context& io_context)
+        : done(false), timer(io_context) {}
+
+    // Indicates if the socket is closed.
+    bool done;
+    // Closes the socket if the peer does not close the connection in time.
+    asio::steady_timer timer;
+    // Receives the input discarded.
+    char buffer[core::BUFFER_SIZE];
+  };
+
+  // The connection attempts of a staggered connection.
+  struct Race {
+    Race(asio::io_context& io_context,
+         const std::vector<asio::ip::tcp::endpoint>& endpoints)
+        : endpoints(endpoints), next(0), pending(0), done(false),
+          generation(0), timer(io_context) {}
+
+    // The endpoints, in the order of the attempts.
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+    // Index of the next endpoint to try.
+    std::size_t next;
+    // Number of attempts in progress.
+    std::size_t pending;
+    // Indicates if the race is over.
+    bool done;
+    // Identifies the last timer armed, a late timer is ignored.
+    std::size_t generation;
+    // Starts the next attempt after the delay.
+    asio::steady_timer timer;
+    // The sockets of the attempts.
+    std::vector<std::shared_ptr<asio::ip::tcp::socket>> sockets;
+  };
+
+  // returns the endpoints with the address families interleaved, starting
+  // with the family of the first one. Their order is kept within a family.
+  static std::vector<asio::ip::tcp::endpoint> interleave(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints) {
+    std::vector<asio::ip::tcp::endpoint> first, second, interleaved;
+    auto v6 = endpoints.front().address().is_v6();
+
+    for (const auto& endpoint : endpoints)
+      (endpoint.address().is_v6() == v6 ? first : second).push_back(endpoint);
+    for (std::size_t i = 0; i < std::max(first.size(), second.size()); ++i) {
+      if (i < first.size()) interleaved.push_back(first[i]);
+      if (i < second.size()) interleaved.push_back(second[i]);
+    }
+    return interleaved;
+  }
+
+  // starts the next connection attempt of the race, and arms the timer
+  // starting the following one. Runs in the strand.
+  void attempt(const std::shared_ptr<Race>& race,
+               const std::function<void(const asio::error_code&)>& completion,
+               const std::chrono::milliseconds& delay) {
+    auto roxanne(shared_from_this());
+    auto socket = std::make_shared<asio::ip::tcp::socket>(service_.get());
+
+    race->sockets.push_back(socket);
+    ++race->pending;
+    // with fast open, the first attempt would always win without reaching
+    // the server.
+    prepare(*socket, race->endpoints[race->next],
+            race->endpoints.size() == 1);
+    socket->async_connect(
+        race->endpoints[race->next++],
+        service_.get_strand().wrap([this, roxanne, race, socket, completion,
+                                    delay](const asio::error_code& error) {
+          --race->pending;
+          if (race->done) return;
+
+          if (not error) {
+            core::Error ignored;
+
+            // the winner is adopted, the other attempts are cancelled.
+            race->done = true;
+            race->timer.cancel(ignored.get());
+            for (auto& other : race->sockets)
+              if (other != socket) other->close(ignored.get());
+            {
+              std::lock_guard<std::mutex> lock(inline_mutex_);
+              socket_.close(ignored.get());
+              socket_ = std::move(*socket);
+            }
+
+            connecting_ = false;
+            connected_ = true;
+            closing_ = false;
+            completion(error);
+            return;
+          }
+
+          // a failure starts the next attempt without waiting for the delay.
+          if (race->next < race->endpoints.size()) {
+            attempt(race, completion, delay);
+          } else if (race->pending == 0) {
+            race->done = true;
+            connecting_ = false;
+            completion(error);
+          }
+        }));
+
+    if (race->next == race->endpoints.size()) return;
+
+    auto generation = ++race->generation;
+    race->timer.expires_after(delay);
+    race->timer.async_wait(service_.get_strand().wrap(
+        [this, roxanne, race, generation, completion,
+         delay](const asio::error_code& error) {
+          if (error or race->done or generation != race->generation or
+              race->next == race->endpoints.size())
+            return;
+          attempt(race, completion, delay);
+        }));
+  }
+
+  // synchronous connection to the first of the endpoints accepting it, tried
+  // one after the other.
+  void connect_sequentially(
+      const std::vector<asio::ip::tcp::endpoint>& endpoints) {
+    core::Error error;
+
+    if (endpoints.empty()) error.get() = asio::error::host_not_found;
+    if (connected_ or connecting_.exchange(true))
+      error.get() = asio::error::already_started;
+    if (error.exist()) error.throw_it();
+
+    for (const auto& endpoint : interleave(endpoints)) {
+      core::Error ignored;
+
+      // a socket which failed to connect cannot be reused.
+      error.get().clear();
+      socket_.close(ignored.get());
+      prepare(socket_, endpoint, endpoints.size() == 1);
+      socket_.connect(endpoint, error.get());
+      if (not error.exist()) break;
+    }
+
+    connecting_ = false;
+    if (error.exist()) error.throw_it();
+    connected_ = true;
+    closing_ = false;
+  }
+
+  // opens the socket before its connection to apply the connection options,
+  // fast open only if allowed. A batch started before the connection corks
+  // the socket. The options not supported are ignored.
+  void prepare(asio::ip::tcp::socket& socket,
+               const asio::ip::tcp::endpoint& endpoint,
+               bool fast_open = true) {
+    core::Error ignored;
+
+    if (not socket.is_open()) socket.open(endpoint.protocol(), ignored.get());
+    options_.apply(socket);
+#ifdef TCP_FASTOPEN_CONNECT
+    if (fast_open and options_.fast_open)
+      socket.set_option(tcp_option<TCP_FASTOPEN_CONNECT>(1), ignored.get());
+#endif
+#ifdef TCP_CORK
+    if (batching_) socket.set_option(tcp_option<TCP_CORK>(1), ignored.get());
+#endif
+  }
+
+  // Queues the message and starts writing if no write is in progress.
   // this function is post through the strand object to ensure that it
   // will be invoked once and at the good moment.
-  void async_send_handler(const std::string& message) {
+  void async_send_handler(
+      const std::string& message,
+      const std::function<void(const asio::error_code&, std::size_t)>&
+          completion,
+      std::size_t sent) {
+    if (closing_ or not socket_.is_open()) {
+      --pending_writes_;
+      if (completion) completion(asio::error::operation_aborted, sent);
+      return;
+    }
+
+    write_queue_.push_back(Write{message, completion, sent});
+    if (not writing_) write_next();
+  }
+
+  // writes as much of the message as the socket buffer takes, without
+  // blocking, and returns the number of bytes written. Called with the
+  // inline_mutex_ held, which keeps the socket open.
+  // Where MSG_NOSIGNAL is not available, nothing is written inline.
+  std::size_t write_inline(const std::string& message) {
+#ifdef MSG_NOSIGNAL
+    auto bytes = ::send(socket_.native_handle(), message.data(),
+                        message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    // on error (e.g: EAGAIN), the asynchronous write takes over.
+    if (bytes > 0) return static_cast<std::size_t>(bytes);
+#endif
+    return 0;
+  }
+
+  // Performs the asio::async_write operation of the queued messages, gathered
+  // in a single write (up to MAX_GATHER of them).
+  // Only one write is in progress at a time, so the messages are never
+  // interleaved on the socket. Runs in the strand.
+  void write_next() {
     auto roxanne(shared_from_this());
+    std::vector<asio::const_buffer> buffers;
+
+    for (const auto& write : write_queue_) {
+      if (buffers.size() == MAX_GATHER) break;
+      buffers.push_back(asio::buffer(write.data));
+    }
+
+    writing_ = true;
     asio::async_write(
-        socket_, asio::buffer(message),
-        service_.get_strand().wrap(
-            [this, roxanne](const asio::error_code& error, std::size_t bytes) {
+        socket_, buffers,
+        service_.get_strand().wrap([this, roxanne, buffers](
+                                       const asio::error_code& error,
+                                       std::size_t) {
+          writing_ = false;
+
+          if (error) {
+            fail_writes(error);
+          } else {
+            for (std::size_t i = 0; i < buffers.size(); ++i) {
+              auto completion = std::move(write_queue_.front().completion);
+              auto bytes = buffers[i].size() + write_queue_.front().sent;
+
+              write_queue_.pop_front();
+              --pending_writes_;
+              if (completion)
+                completion(error, bytes);
+              else if (write_handler_)
+                write_handler_(bytes, *this);
+            }
+          }
+
+          if (not write_queue_.empty())
+            write_next();
+          else if (closing_)
+            graceful_close();
+          else if (uncork_)
+            uncork();
+        }));
+  }
+
+  // sets or clears TCP_CORK, ignored where not supported.
+  void cork(bool enable) {
+#ifdef TCP_CORK
+    core::Error ignored;
+    socket_.set_option(tcp_option<TCP_CORK>(enable), ignored.get());
+#endif
+  }
+
+  // uncorks the socket once a batch is written, unless a new batch started.
+  // Runs in the strand.
+  void uncork() {
+    std::lock_guard<std::mutex> lock(inline_mutex_);
+
+    uncork_ = false;
+    if (not batching_ and socket_.is_open()) cork(false);
+  }
+
+  // drops the queued messages, their completions receive the error.
+  // Runs in the strand.
+  void fail_writes(const asio::error_code& error) {
+    auto unhandled = false;
+
+    while (not write_queue_.empty()) {
+      auto completion = std::move(write_queue_.front().completion);
+      write_queue_.pop_front();
+      --pending_writes_;
+      if (completion)
+        completion(error, 0);
+      else
+        unhandled = true;
+    }
+    if (unhandled and error != asio::error::operation_aborted) report(error);
+  }
+
+  // half-closes the socket once the write queue is flushed, then reads and
+  // discards the input until the end-of-file of the peer (or the close
+  // timeout) before closing it. Closing a socket with unread input makes
+  // the kernel reset the connection, and the peer may lose what it has not
+  // read yet. Runs in the strand.
+  void graceful_close() {
+    auto roxanne(shared_from_this());
+    core::Error error;
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      socket_.shutdown(asio::ip::tcp::socket::shutdown_send, error.get());
+    }
+    if (error.exist()) {
+      finish_close(nullptr);
+      return;
+    }
+
+    auto linger = std::make_shared<Linger>(service_.get());
+    linger->timer.expires_after(close_timeout_);
+    linger->timer.async_wait(service_.get_strand().wrap(
+        [this, roxanne, linger](const asio::error_code& error) {
+          // the pending read is aborted by the close.
+          if (not error and not linger->done) finish_close(linger);
+        }));
+    drain(linger);
+  }
+
+  // reads and discards the input until the end-of-file. Runs in the strand.
+  void drain(const std::shared_ptr<Linger>& linger) {
+    auto roxanne(shared_from_this());
+
+    socket_.async_read_some(
+        asio::buffer(linger->buffer, core::BUFFER_SIZE),
+        service_.get_strand().wrap([this, roxanne, linger](
+                                       const asio::error_code& error,
+                                       std::size_t) {
+          if (linger->done) return;
+          if (error)
+            finish_close(linger);
+          else
+            drain(linger);
+        }));
+  }
 
-              if (error) throw asio::system_error(error);
+  // closes the socket and invokes the close handler. Runs in the strand.
+  void finish_close(const std::shared_ptr<Linger>& linger) {
+    core::Error error;
 
-              if (not bytes)
-                throw core::Error::Write(
-                    "Unexpected error occurred. asio::async_write failed;");
+    if (linger) {
+      linger->done = true;
+      linger->timer.cancel(error.get());
+    }
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      socket_.close(error.get());
+    }
+    abort_batch();
 
-              std::mutex mutex;
-              // lock the execution of the handler to guarantee the thread
-              // safety.
-              std::lock_guard<std::mutex> lock(mutex);
-              if (write_handler_) write_handler_(bytes, *shared_from_this());
-            }));
+    auto callback = std::move(close_handler_);
+    close_handler_ = nullptr;
+    if (callback) callback(*this);
+  }
+
+  // shuts down and closes the socket. Runs in the strand.
+  void close() {
+    core::Error error;
+    {
+      // an inline write never sees the descriptor closed under it.
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      // asio error_code provided to ensure that no exception will be thrown.
+      socket_.shutdown(asio::ip::tcp::socket::shutdown_both, error.get());
+      socket_.close(error.get());
+    }
+    if (not writing_) fail_writes(asio::error::operation_aborted);
+    abort_batch();
+  }
+
+  // ends the batch in progress once the socket is closed: its messages are
+  // dropped, their completions receive operation_aborted, and the next
+  // connection starts without batch. Runs in the strand.
+  void abort_batch() {
+    std::vector<Write> batch;
+    {
+      std::lock_guard<std::mutex> lock(inline_mutex_);
+      batching_ = false;
+      batch.swap(batch_);
+    }
+    for (auto& write : batch)
+      if (write.completion)
+        write.completion(asio::error::operation_aborted, 0);
   }
 
   // Performs an asynchronous read on the socket.
   // this function is post through the strand object to ensure that it
   // will be invoked once and at the good moment.
-  void async_receive_handler() {
+  void async_receive_handler(
+      const std::function<void(const asio::error_code&, std::string)>&
+          completion) {
     auto roxanne(shared_from_this());
     socket_.async_read_some(
         asio::buffer(buffer_, core::BUFFER_SIZE),
-        service_.get_strand().wrap(
-            [this, roxanne](const asio::error_code& error, std::size_t bytes) {
-
-              if (error) throw asio::system_error(error);
-
-              if (not bytes)
-                throw core::Error::Read(
-                    "Unexpected error occurred. asio::async_read failed.");
-
-              std::mutex mutex;
-              std::lock_guard<std::mutex> lock(mutex);
-              // lock the execution of the handler to guarantee the thread
-              // safety.
-              if (read_handler_)
-                read_handler_(std::string(buffer_), *shared_from_this());
-              std::memset(buffer_, 0, core::BUFFER_SIZE);
-            }));
+        service_.get_strand().wrap([this, roxanne, completion](
+            const asio::error_code& error, std::size_t bytes) {
+
+          if (completion) {
+            completion(error, std::string(buffer_, bytes));
+            return;
+          }
+
+          if (error) {
+            if (error != asio::error::operation_aborted) report(error);
+            return;
+          }
+
+          if (read_handler_)
+            read_handler_(std::string(buffer_, bytes), *this);
+        }));
   }
 
   // A reference on the service to perform I/O operations.
   core::Service& service_;
 
+  // The options of the socket.
+  SocketOptions options_;
+
   // Thread safe boolean to know if the stream is connected.
   std::atomic<bool> connected_;
 
+  // Thread safe boolean to know if an asynchronous connection is in progress.
+  std::atomic<bool> connecting_;
+
+  // A message waiting to be written and its optional completion.
+  struct Write {
+    std::string data;
+    std::function<void(const asio::error_code&, std::size_t)> completion;
+    // bytes of the message already written inline.
+    std::size_t sent;
+  };
+
+  // Messages waiting to be written, only accessed from the strand.
+  std::deque<Write> write_queue_;
+
+  // Indicates if a write is in progress, only accessed from the strand.
+  bool writing_;
+
+  // Indicates if a graceful close is in progress, only modified from the
+  // strand.
+  std::atomic<bool> closing_;
+
+  // Number of messages queued or waiting for the strand, the messages are
+  // written inline only when there is none.
+  std::atomic<std::size_t> pending_writes_;
+
+  // Held by the inline writes, and while the socket is closed or replaced.
+  std::mutex inline_mutex_;
+
+  // Indicates if a batch is in progress, cf: begin_batch.
+  std::atomic<bool> batching_;
+
+  // Messages of the batch in progress, protected by the inline_mutex_.
+  std::vector<Write> batch_;
+
+  // Indicates if the socket is uncorked once the write queue is flushed,
+  // only accessed from the strand.
+  bool uncork_;
+
+  // Maximum number of messages gathered in a single write.
+  static constexpr std::size_t MAX_GATHER = 64;
+
+  // Handler invoked once the graceful close is completed.
+  std::function<void(Stream&)> close_handler_;
+
+  // Time given to the peer to close the connection after a graceful close.
+  std::chrono::milliseconds close_timeout_;
+
   // TCP socket.
   asio::ip::tcp::socket socket_;
 
@@ -523,6 +2095,9 @@ class Stream : public std::enable_shared_from_this<Stream> {
 
   // Asynchronous send handler.
   std::function<void(std::size_t, Stream&)> write_handler_;
+
+  // Asynchronous operations error handler.
+  std::function<void(const asio::error_code&, Stream&)> error_handler_;
 };
 
 }  // namespace network
@@ -553,11 +2128,60 @@ namespace tcp {
 */
 class Client {
  public:
+  // Says whether the data received is a complete response.
+  typedef std::function<bool(const std::string&)> predicate;
+
   // Ctor
+  // the client owns its service, and thus its I/O thread.
   explicit Client(const std::string& host, const std::string& port)
       : host_(host),
         port_(port),
-        session_(network::Stream::new_session(service_)) {}
+        owned_service_(new core::Service),
+        service_(*owned_service_),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client runs on an externally owned service (e.g: taken from a
+  // core::ServicePool), shared with other clients. Thousands of connections
+  // can thus share a handful of I/O threads. The service must outlive the
+  // client, and it is not stopped by the client.
+  explicit Client(const std::string& host, const std::string& port,
+                  core::Service& service)
+      : host_(host),
+        port_(port),
+        service_(service),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client connects to the given endpoints, already resolved, instead of
+  // resolving a host: the connections never wait for the DNS. The endpoints
+  // are tried in order, and must not be empty.
+  explicit Client(const network::Resolver::endpoints& endpoints)
+      : host_(endpoints.front().address().to_string()),
+        port_(std::to_string(endpoints.front().port())),
+        endpoints_(endpoints),
+        owned_service_(new core::Service),
+        service_(*owned_service_),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
+
+  // Ctor
+  // the client connects to the given endpoints, already resolved, and runs on
+  // an externally owned service.
+  explicit Client(const network::Resolver::endpoints& endpoints,
+                  core::Service& service)
+      : host_(endpoints.front().address().to_string()),
+        port_(std::to_string(endpoints.front().port())),
+        endpoints_(endpoints),
+        service_(service),
+        session_(network::Stream::new_session(service_)),
+        reconnection_(std::make_shared<Reconnection>(this)),
+        timer_(service_.get()) {}
 
   // Copy Ctor
   Client(const Client&) = delete;
@@ -565,18 +2189,32 @@ class Client {
   Client& operator=(const Client&) = delete;
 
   // Dtor
-  ~Client() noexcept { disconnect(); }
+  ~Client() noexcept {
+    disconnect();
+    // the pending handlers of the reconnection become no-ops.
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    reconnection_->client = nullptr;
+  }
 
   // performs a synchronous connection
+  // the endpoints of the host are tried with staggered attempts, the first
+  // one accepting the connection wins (cf: Stream::async_connect). The name
+  // resolution is cached (cf: network::Resolver).
   void connect() {
+    auto called = false;
+
     try {
       if (is_connected()) throw core::Error::User("Client Already connected.");
+      if (not admitted()) return;
+
+      auto start = std::chrono::steady_clock::now();
+      called = true;
       session_->service().run();
-      asio::ip::tcp::resolver resolver(service_.get());
-      session_->connect(
-          *resolver.resolve(asio::ip::tcp::resolver::query(host_, port_)));
+      session_->connect(resolve());
+      if (breaker_) breaker_->success(std::chrono::steady_clock::now() - start);
     } catch (std::exception& e) {
       core::Error::print(e.what());
+      if (called and breaker_) breaker_->failure();
     }
   }
 
@@ -587,38 +2225,136 @@ class Client {
   //
   //  A callback could be provided and it will be invoked when the asynchronous
   //  connection will be completed.
+  //  async_connect does not wait for the name resolution nor for the
+  //  connection: the client is connected once the callback is invoked.
+  //  A failure of the connection is reported to the error handler.
   void async_connect(
       const std::function<void(network::Stream&)>& callback = nullptr) {
     try {
       if (is_connected()) throw core::Error::User("Client Already connected.");
-      asio::ip::tcp::resolver resolver(service_.get());
-      session_->async_connect(
-          *resolver.resolve(asio::ip::tcp::resolver::query(host_, port_)),
-          callback);
+      if (not admitted()) return;
+
+      auto session = session_;
+      auto breaker = breaker_;
+      auto reconnection = reconnection_;
+      auto start = std::chrono::steady_clock::now();
+
+      service_.run();
+      async_resolve([session, breaker, reconnection, start, callback](
+          const asio::error_code& error,
+          const network::Resolver::endpoints& endpoints) {
+        if (error) {
+          if (breaker) breaker->failure();
+          core::Error::print(error.message());
+          return;
+        }
+
+        // the resolver runs on its own thread: the connection is started
+        // from the strand of the client, unless the client is destroyed
+        // (with its service) meanwhile.
+        std::lock_guard<std::mutex> lock(reconnection->mutex);
+        auto client = reconnection->client;
+
+        if (not client) return;
+        client->service_.get_strand().post([session, breaker, reconnection,
+                                            start, callback, endpoints]() {
+          std::lock_guard<std::mutex> lock(reconnection->mutex);
+          if (not reconnection->client) return;
+          if (not breaker) return session->async_connect(endpoints, callback);
+
+          session->async_connect(endpoints, [session, breaker, reconnection,
+                                             start, callback](
+                                                const asio::error_code& error) {
+            record(breaker, error, start);
+            if (error)
+              report(reconnection, error, *session);
+            else if (callback)
+              callback(*session);
+          });
+        });
+      });
     } catch (std::exception& e) {
       core::Error::print(e.what());
     }
   }
 
+  // enables the reconnecting mode.
+  //
+  //  @param:
+  //    - capacity, the maximum number of messages buffered while disconnected.
+  //    - backoff, the delays between the reconnection attempts.
+  //
+  //  When a send fails, or when sending while the client is not connected,
+  //  the client reconnects in background instead of giving up, retrying with
+  //  the given backoff. Meanwhile, the messages passed to send and async_send
+  //  are buffered and then replayed in order once reconnected. The messages
+  //  beyond the capacity are dropped.
+  //  A failed message is buffered entirely, the server may thus receive it
+  //  twice if it was partially written.
+  //  disconnect() leaves the reconnecting mode and drops the buffer.
+  void enable_reconnect(std::size_t capacity = 1024,
+                        const core::Backoff& backoff = core::Backoff()) {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    reconnection_->enabled = true;
+    reconnection_->capacity = capacity;
+    reconnection_->backoff = backoff;
+  }
+
+  // returns the number of messages waiting for the reconnection.
+  std::size_t buffered() {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    return reconnection_->buffered.size();
+  }
+
   // disconnect the client by stopping the service and closing the session
+  // a shared service is not stopped.
   void disconnect() {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      core::Error error;
+
+      reconnection_->enabled = false;
+      reconnection_->pending = false;
+      reconnection_->buffered.clear();
+      timer_.cancel(error.get());
+    }
+
     if (is_connected()) {
       session_->disconnect();
-      service_.stop();
+      if (owned_service_) service_.stop();
     }
   }
 
+  // asynchronous and graceful disconnection.
+  // the pending asynchronous sends are flushed, then the connection is
+  // half-closed and closed. The callback is invoked once it is done.
+  // Unlike disconnect, the service is not stopped, so it can be called from
+  // a handler.
+  void async_disconnect(
+      const std::function<void(network::Stream&)>& callback = nullptr) {
+    session_->async_disconnect(callback);
+  }
+
   // synchronous sending of data
   std::size_t send(const std::string& message) {
     std::size_t bytes = 0;
+    auto called = false;
 
     try {
-      if (not is_connected())
+      if (not is_connected()) {
+        if (defer(message)) return bytes;
         throw core::Error::User("Client is not connected.");
+      }
+      if (not admitted()) return bytes;
+
+      auto start = std::chrono::steady_clock::now();
+      called = true;
       bytes = session_->send(message);
+      if (breaker_) breaker_->success(std::chrono::steady_clock::now() - start);
     } catch (std::exception& e) {
       core::Error::print(e.what());
-      disconnect();
+      if (called and breaker_) breaker_->failure();
+      if (not defer(message)) disconnect();
     }
     return bytes;
   }
@@ -626,25 +2362,65 @@ class Client {
   // asynchronous sending of data
   void async_send(const std::string& message) {
     try {
-      if (not is_connected())
+      if (not is_connected()) {
+        if (defer(message)) return;
         throw core::Error::User("Client is not connected.");
-      session_->async_send(message);
+      }
+      if (not admitted()) return;
+      if (reconnecting())
+        track(message);
+      else if (breaker_)
+        observe(message);
+      else
+        session_->async_send(message);
     } catch (std::exception& e) {
       core::Error::print(e.what());
       disconnect();
     }
   }
 
+  // asynchronous send of data returning a future.
+  // the future is completed from the I/O thread with the number of bytes
+  // sent, or holds the error of the operation. Many sends can be issued and
+  // then waited on in bulk.
+  std::future<std::size_t> send_async(const std::string& message) {
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    auto breaker = breaker_;
+    auto start = std::chrono::steady_clock::now();
+
+    if (not is_connected())
+      promise->set_exception(std::make_exception_ptr(
+          core::Error::User("Client is not connected.")));
+    else if (breaker and not breaker->allow())
+      promise->set_exception(std::make_exception_ptr(core::Error::Connection(
+          "Circuit breaker open for " + host_ + ":" + port_ + ".")));
+    else
+      session_->async_send(message, [promise, breaker, start](
+                                        const asio::error_code& error,
+                                        std::size_t bytes) {
+        record(breaker, error, start);
+        core::complete(*promise, error, bytes);
+      });
+    return promise->get_future();
+  }
+
   // synchronous receive
   std::string receive() {
     std::string received("");
+    auto called = false;
 
     try {
       if (not is_connected())
         throw core::Error::User("Client is not connected.");
+      if (not admitted()) return received;
+
+      called = true;
       received = session_->receive();
+      // waiting for the data is not a latency of the server.
+      if (breaker_) breaker_->success();
     } catch (std::exception& e) {
       core::Error::print(e.what());
+      if (called and breaker_) breaker_->failure();
       disconnect();
     }
     return received;
@@ -662,10 +2438,31 @@ class Client {
     }
   }
 
+  // asynchronous receive returning a future.
+  // the future is completed from the I/O thread with the data received, or
+  // holds the error of the operation.
+  std::future<std::string> receive_async() {
+    auto promise = std::make_shared<std::promise<std::string>>();
+
+    if (not is_connected())
+      promise->set_exception(std::make_exception_ptr(
+          core::Error::User("Client is not connected.")));
+    else
+      session_->async_receive([promise](const asio::error_code& error,
+                                        std::string received) {
+        core::complete(*promise, error, received);
+      });
+    return promise->get_future();
+  }
+
   // set the handler which will be invoked when the asynchronous send operation
   //  will be performed.
   void set_send_handler(
       const std::function<void(std::size_t, network::Stream&)>& callback) {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      reconnection_->send_handler = callback;
+    }
     session_->set_write_handler(callback);
   }
 
@@ -676,18 +2473,373 @@ class Client {
     session_->set_read_handler(callback);
   }
 
+#ifdef HERMES_COROUTINES
+  // co_await-able connection.
+  auto co_connect() {
+    if (is_connected()) throw core::Error::User("Client Already connected.");
+    session_->service().run();
+    return session_->co_connect(resolve().front());
+  }
+
+  // co_await-able send, returns the number of bytes sent.
+  auto co_send(const std::string& message) {
+    if (not is_connected()) throw core::Error::User("Client is not connected.");
+    return session_->co_send(message);
+  }
+
+  // co_await-able receive, returns the data received.
+  auto co_receive() {
+    if (not is_connected()) throw core::Error::User("Client is not connected.");
+    return session_->co_receive();
+  }
+#endif  // HERMES_COROUTINES
+
+  // set the handler which will be invoked when an asynchronous operation
+  // fails.
+  void set_error_handler(
+      const std::function<void(const asio::error_code&, network::Stream&)>&
+          callback) {
+    {
+      std::lock_guard<std::mutex> lock(reconnection_->mutex);
+      reconnection_->error_handler = callback;
+    }
+    session_->set_error_handler(callback);
+  }
+
+  // sets the circuit breaker guarding the calls to the server, nullptr to
+  // disable it (default). Use core::CircuitBreaker::of(host + ":" + port) to
+  // share the breaker of the server with its other clients.
+  // While the breaker is open, connect, send and receive fail immediately,
+  // as well as async_connect, async_send and send_async. The outcome of the
+  // asynchronous calls is recorded once they complete.
+  // NOTE: must be set before the client is used.
+  void set_circuit_breaker(
+      const std::shared_ptr<core::CircuitBreaker>& breaker) {
+    breaker_ = breaker;
+  }
+
+  // enables TCP Fast Open on the next connections, cf:
+  // network::Stream::set_fast_open.
+  void set_fast_open(bool enable) { session_->set_fast_open(enable); }
+
+  // starts a batch of asynchronous sends, written together by flush, cf:
+  // network::Stream::begin_batch.
+  void begin_batch() { session_->begin_batch(); }
+
+  // writes the batch of asynchronous sends.
+  void flush() { session_->flush(); }
+
+  // sets the options of the connection, cf: network::SocketOptions.
+  void set_options(const network::SocketOptions& options) {
+    session_->set_options(options);
+  }
+
+  // sets the cache of the responses to the requests, nullptr to disable it
+  // (default). A cache can be shared by the clients of a same server.
+  // NOTE: must be set before the client is used.
+  void set_cache(const std::shared_ptr<core::Cache>& cache) { cache_ = cache; }
+
+  // synchronous request: sends the payload and returns the data received in
+  // response. The data is received until the predicate says the response is
+  // complete (e.g: ends_with("\n")), a response may indeed be split across
+  // several reads. With a cache, an answered request identified by the same
+  // key is served from the cache, without reaching the network. A response
+  // interrupted by an error is returned as is, but never cached.
+  // Only use it for idempotent requests.
+  std::string request(const std::string& key, const std::string& payload,
+                      const predicate& complete) {
+    std::string response("");
+
+    if (cache_ and cache_->get(key, response)) return response;
+    if (not send(payload)) return response;
+    while (not complete(response)) {
+      auto received = receive();
+
+      if (received.empty()) return response;
+      response += received;
+    }
+    if (cache_) cache_->put(key, response);
+    return response;
+  }
+
+  // synchronous request identified by its payload.
+  std::string request(const std::string& payload, const predicate& complete) {
+    return request(payload, payload, complete);
+  }
+
+  // returns a predicate saying that a response is complete once it ends with
+  // the delimiter, for the line-based protocols.
+  static predicate ends_with(const std::string& delimiter) {
+    return [delimiter](const std::string& response) {
+      return response.size() >= delimiter.size() and
+             response.compare(response.size() - delimiter.size(),
+                              delimiter.size(), delimiter) == 0;
+    };
+  }
+
   // returns true whether the client is connected, false otherwise.
   bool is_connected() { return session_->is_connected(); }
 
+  // returns true whether the connection is still usable: the server has not
+  // closed it and no error is pending on the socket.
+  bool is_alive() { return session_->is_alive(); }
+
  private:
+  // State of the reconnecting mode, shared with the handlers of the
+  // reconnection which can outlive the client.
+  struct Reconnection {
+    explicit Reconnection(Client* owner)
+        : client(owner), enabled(false), pending(false), capacity(0) {}
+
+    // Protects the state and the client from its handlers.
+    std::mutex mutex;
+    // The client, nullptr once destroyed.
+    Client* client;
+    // Indicates if the reconnecting mode is enabled.
+    bool enabled;
+    // Indicates if a reconnection is scheduled or in progress.
+    bool pending;
+    // The maximum number of messages buffered.
+    std::size_t capacity;
+    // The messages waiting for the reconnection.
+    std::deque<std::string> buffered;
+    // The delays between the attempts.
+    core::Backoff backoff;
+    // The send handler, invoked for the tracked sends.
+    std::function<void(std::size_t, network::Stream&)> send_handler;
+    // The error handler, invoked for the observed calls.
+    std::function<void(const asio::error_code&, network::Stream&)>
+        error_handler;
+  };
+
+  // returns false if the circuit breaker refuses the call, which is then
+  // failed immediately. Once allowed, the outcome of the call must be
+  // recorded, as it can be the probe of a half-open breaker.
+  bool admitted() {
+    if (not breaker_ or breaker_->allow()) return true;
+    core::Error::print("Circuit breaker open for " + host_ + ":" + port_ + ".");
+    return false;
+  }
+
+  // records the outcome of an asynchronous call started at start.
+  static void record(const std::shared_ptr<core::CircuitBreaker>& breaker,
+                     const asio::error_code& error,
+                     const std::chrono::steady_clock::time_point& start) {
+    if (not breaker) return;
+    if (error)
+      breaker->failure();
+    else
+      breaker->success(std::chrono::steady_clock::now() - start);
+  }
+
+  // reports the error of an observed call to the error handler, as the
+  // stream would have done.
+  static void report(const std::shared_ptr<Reconnection>& reconnection,
+                     const asio::error_code& error, network::Stream& session) {
+    std::unique_lock<std::mutex> lock(reconnection->mutex);
+    auto handler = reconnection->error_handler;
+
+    // the handler is invoked unlocked, it can use the client.
+    lock.unlock();
+    if (handler)
+      handler(error, session);
+    else
+      core::Error::print(error.message());
+  }
+
+  // sends the message, its outcome is recorded by the circuit breaker and
+  // then reported to the send or error handler.
+  void observe(const std::string& message) {
+    auto session = session_;
+    auto breaker = breaker_;
+    auto reconnection = reconnection_;
+    auto start = std::chrono::steady_clock::now();
+
+    session_->async_send(message, [session, breaker, reconnection, start](
+                                      const asio::error_code& error,
+                                      std::size_t bytes) {
+      record(breaker, error, start);
+      if (error) {
+        // a message dropped by a close is not an error of the server.
+        if (error != asio::error::operation_aborted)
+          report(reconnection, error, *session);
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(reconnection->mutex);
+      auto handler = reconnection->send_handler;
+      lock.unlock();
+      if (handler) handler(bytes, *session);
+    });
+  }
+
+  // returns true whether the reconnecting mode is enabled.
+  bool reconnecting() {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+    return reconnection_->enabled;
+  }
+
+  // buffers the message and schedules a reconnection.
+  // returns false if the reconnecting mode is disabled.
+  bool defer(const std::string& message) {
+    std::lock_guard<std::mutex> lock(reconnection_->mutex);
+
+    if (not reconnection_->enabled) return false;
+    buffer(message);
+    schedule();
+    return true;
+  }
+
+  // buffers the message to be replayed once reconnected, drops it if the
+  // buffer is full. reconnection_->mutex must be locked.
+  void buffer(const std::string& message) {
+    if (reconnection_->buffered.size() < reconnection_->capacity)
+      reconnection_->buffered.push_back(message);
+    else
+      core::Error::print("Reconnecting, buffer full. Message dropped.");
+  }
+
+  // schedules a reconnection attempt after the next backoff delay, unless one
+  // is pending. reconnection_->mutex must be locked.
+  void schedule() {
+    if (reconnection_->pending) return;
+
+    auto reconnection = reconnection_;
+
+    reconnection_->pending = true;
+    service_.run();
+    timer_.expires_after(reconnection_->backoff.next());
+    timer_.async_wait(service_.get_strand().wrap(
+        [reconnection](const asio::error_code& error) {
+          std::lock_guard<std::mutex> lock(reconnection->mutex);
+          if (error or not reconnection->client or not reconnection->enabled)
+            return;
+          reconnection->client->reconnect();
+        }));
+  }
+
+  // closes the broken connection, resolves the host again (its address may
+  // have changed across a restart, once the cache entry expired) and
+  // connects. Runs in the strand, reconnection_->mutex locked.
+  void reconnect() {
+    auto reconnection = reconnection_;
+
+    session_->disconnect();
+    async_resolve([reconnection](
+        const asio::error_code& error,
+        const network::Resolver::endpoints& endpoints) {
+      std::lock_guard<std::mutex> lock(reconnection->mutex);
+      auto client = reconnection->client;
+
+      if (not client or not reconnection->enabled) return;
+      client->service_.get_strand().post([reconnection, error, endpoints]() {
+        std::lock_guard<std::mutex> lock(reconnection->mutex);
+        auto client = reconnection->client;
+
+        if (not client or not reconnection->enabled) return;
+        if (error) return client->retry();
+
+        client->session_->async_connect(
+            endpoints, [reconnection](const asio::error_code& error) {
+              std::lock_guard<std::mutex> lock(reconnection->mutex);
+              auto client = reconnection->client;
+
+              if (not client or not reconnection->enabled) return;
+              if (error)
+                client->retry();
+              else
+                client->replay();
+            });
+      });
+    });
+  }
+
+  // returns the endpoints given at construction, or resolves host:port with
+  // the shared resolver, waiting only on a cache miss.
+  network::Resolver::endpoints resolve() {
+    if (not endpoints_.empty()) return endpoints_;
+    return network::Resolver::shared().resolve(host_, port_);
+  }
+
+  // asynchronous version of resolve, the callback is never invoked from the
+  // calling thread.
+  void async_resolve(const network::Resolver::callback& callback) {
+    if (endpoints_.empty())
+      return network::Resolver::shared().async_resolve(host_, port_, callback);
+
+    auto endpoints = endpoints_;
+    service_.run();
+    service_.post([callback, endpoints]() {
+      callback(asio::error_code(), endpoints);
+    });
+  }
+
+  // schedules the next attempt. reconnection_->mutex must be locked.
+  void retry() {
+    reconnection_->pending = false;
+    schedule();
+  }
+
+  // sends the buffered messages, in order, once reconnected.
+  // reconnection_->mutex must be locked.
+  void replay() {
+    std::deque<std::string> buffered;
+
+    buffered.swap(reconnection_->buffered);
+    reconnection_->pending = false;
+    reconnection_->backoff.reset();
+    for (const auto& message : buffered) track(message);
+  }
+
+  // asynchronous send of data, buffered again on failure to be replayed after
+  // the reconnection.
+  void track(const std::string& message) {
+    auto reconnection = reconnection_;
+    auto breaker = breaker_;
+    auto start = std::chrono::steady_clock::now();
+
+    session_->async_send(message, [reconnection, breaker, start, message](
+                                      const asio::error_code& error,
+                                      std::size_t bytes) {
+      record(breaker, error, start);
+      std::unique_lock<std::mutex> lock(reconnection->mutex);
+      auto client = reconnection->client;
+
+      if (not client or not reconnection->enabled) return;
+      if (error) {
+        client->buffer(message);
+        client->schedule();
+        return;
+      }
+
+      // the handler is invoked unlocked, it can send again.
+      auto handler = reconnection->send_handler;
+      auto session = client->session_;
+      lock.unlock();
+      if (handler) handler(bytes, *session);
+    });
+  }
+
   // the host to wich the client is connected.
   std::string host_;
   // the port used to connect to the given host.
   std::string port_;
+  // The endpoints of the host, if given at construction.
+  network::Resolver::endpoints endpoints_;
+  // The service owned by the client, if not shared.
+  std::unique_ptr<core::Service> owned_service_;
   // I/O services.
-  core::Service service_;
+  core::Service& service_;
   // The connection to the host.
   network::Stream::session session_;
+  // The reconnecting mode.
+  std::shared_ptr<Reconnection> reconnection_;
+  // Delays the reconnection attempts.
+  asio::steady_timer timer_;
+  // The circuit breaker of the server, if any.
+  std::shared_ptr<core::CircuitBreaker> breaker_;
+  // The cache of the responses, if any.
+  std::shared_ptr<core::Cache> cache_;
 };
 
 }  // namespace tcp
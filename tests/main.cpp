@@ -88,6 +88,37 @@ SCENARIO("I/O Services", "[core]") {
       service.stop();
       REQUIRE(service.is_stop());
     }
+
+    WHEN(
+        "Running the service again once stopped."
+        "\n>>> the service should be restarted") {
+      std::promise<void> done;
+
+      service.run();
+      service.stop();
+      service.run();
+      REQUIRE(not service.is_stop());
+
+      service.post([&done]() { done.set_value(); });
+      REQUIRE(done.get_future().wait_for(std::chrono::seconds(5)) ==
+              std::future_status::ready);
+      service.stop();
+    }
+
+    WHEN(
+        "Running the service from several threads at once."
+        "\n>>> a single thread should be started") {
+      std::vector<std::thread> threads;
+      std::promise<void> done;
+
+      for (int i = 0; i < 8; ++i)
+        threads.push_back(std::thread([&service]() { service.run(); }));
+      for (auto& thread : threads) thread.join();
+
+      service.post([&done]() { done.set_value(); });
+      REQUIRE_NOTHROW(done.get_future().get());
+      service.stop();
+    }
   }
 }
 
@@ -138,6 +169,93 @@ SCENARIO("Dedicated class for Error handling", "[core]") {
   }
 }
 
+SCENARIO("testing the circuit breaker", "[core]") {
+  GIVEN("a breaker opening at 50% of failures over 4 calls, for 100ms") {
+    CircuitBreaker breaker(0.5, 4, std::chrono::milliseconds(100));
+
+    REQUIRE(breaker.state() == CircuitBreaker::CLOSED);
+
+    WHEN("the calls fail") {
+      breaker.success();
+      breaker.failure();
+      breaker.success();
+      REQUIRE(breaker.allow());
+      breaker.failure();
+
+      THEN("the breaker opens, then lets a probe through") {
+        REQUIRE(breaker.state() == CircuitBreaker::OPEN);
+        REQUIRE_FALSE(breaker.allow());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+        REQUIRE(breaker.state() == CircuitBreaker::HALF_OPEN);
+        REQUIRE(breaker.allow());
+        REQUIRE_FALSE(breaker.allow());
+
+        breaker.failure();
+        REQUIRE(breaker.state() == CircuitBreaker::OPEN);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+        REQUIRE(breaker.allow());
+        breaker.success();
+        REQUIRE(breaker.state() == CircuitBreaker::CLOSED);
+      }
+    }
+
+    WHEN("the calls are slow") {
+      CircuitBreaker slow(0.5, 2, std::chrono::milliseconds(100),
+                          std::chrono::milliseconds(10));
+
+      slow.success(std::chrono::milliseconds(1));
+      slow.success(std::chrono::milliseconds(20));
+      REQUIRE(slow.state() == CircuitBreaker::OPEN);
+    }
+  }
+
+  GIVEN("a client to a server down, guarded by a breaker") {
+    hermes::tcp::Client client("127.0.0.1", "50599");
+    auto breaker = std::make_shared<CircuitBreaker>(
+        0.5, 2, std::chrono::seconds(10));
+
+    client.set_circuit_breaker(breaker);
+    REQUIRE(CircuitBreaker::of("127.0.0.1:50599") ==
+            CircuitBreaker::of("127.0.0.1:50599"));
+
+    WHEN("the connections fail") {
+      client.connect();
+      client.connect();
+
+      THEN("the next calls fail immediately") {
+        REQUIRE(breaker->state() == CircuitBreaker::OPEN);
+
+        auto start = std::chrono::steady_clock::now();
+        client.connect();
+        REQUIRE_FALSE(client.is_connected());
+        REQUIRE(std::chrono::steady_clock::now() - start <
+                std::chrono::milliseconds(10));
+      }
+    }
+
+    WHEN("the asynchronous connections fail") {
+      std::atomic<int> failures(0);
+
+      client.set_error_handler(
+          [&](const asio::error_code&, Stream&) { ++failures; });
+      for (int i = 1; i <= 2; ++i) {
+        client.async_connect();
+        while (failures < i) std::this_thread::yield();
+      }
+
+      THEN("the breaker opens") {
+        REQUIRE(breaker->state() == CircuitBreaker::OPEN);
+
+        client.async_connect();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(failures == 2);
+      }
+    }
+  }
+}
+
 SCENARIO("testing Stream session features and thread safety", "[network]") {
   GIVEN("I/O service object") {
     Service service;
@@ -517,6 +635,1676 @@ SCENARIO("testing Stream session features and thread safety", "[network]") {
 //   }
 // }
 
+SCENARIO("testing udp multicast sender and receiver", "[udp]") {
+  GIVEN("a multicast receiver and sender on group 239.255.0.1:50502") {
+    hermes::udp::MulticastReceiver receiver("239.255.0.1", "50502");
+    hermes::udp::MulticastSender sender("239.255.0.1", "50502");
+
+    sender.set_loopback(true);
+
+    WHEN("publishing a datagram to the group") {
+      std::atomic<bool> received(false);
+
+      receiver.set_receive_handler([&](std::string message,
+                                       const asio::ip::udp::endpoint& from,
+                                       Datagram& datagram) {
+        REQUIRE(message == "market data");
+        received = true;
+      });
+      receiver.run();
+
+      for (int i = 0; i < 50 and not received; ++i) {
+        REQUIRE(sender.send("market data") == 11);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+
+      REQUIRE(received);
+      receiver.stop();
+    }
+
+    WHEN("leaving the group") {
+      REQUIRE_NOTHROW(receiver.leave("239.255.0.1"));
+    }
+  }
+}
+
+SCENARIO("testing udp receive errors", "[udp]") {
+  GIVEN("a datagram session on port 50532 connected to the closed port 50533") {
+    hermes::core::Service service;
+    auto session = Datagram::new_session(service);
+    asio::ip::udp::endpoint local(asio::ip::address::from_string("127.0.0.1"),
+                                  50532);
+    asio::ip::udp::endpoint peer(asio::ip::address::from_string("127.0.0.1"),
+                                 50533);
+    std::promise<std::string> received;
+
+    service.run();
+    session->bind(local);
+    session->connect(peer);
+    session->set_read_handler([&](std::string message,
+                                  const asio::ip::udp::endpoint& from,
+                                  Datagram& datagram) {
+      received.set_value(message);
+    });
+
+    WHEN("the peer refuses a datagram, without error handler") {
+      session->async_receive();
+      session->send("lost");
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      // the receive is armed again.
+      auto other = Datagram::new_session(service);
+      other->bind(peer);
+      other->send_to("hello", local);
+      REQUIRE(received.get_future().get() == "hello");
+    }
+
+    WHEN("the peer refuses a datagram, with an error handler") {
+      std::promise<asio::error_code> failed;
+
+      session->set_error_handler(
+          [&](const asio::error_code& error, Datagram& datagram) {
+            failed.set_value(error);
+          });
+      session->async_receive();
+      session->send("lost");
+      REQUIRE(failed.get_future().get() == asio::error::connection_refused);
+    }
+
+    session->close();
+  }
+}
+
+SCENARIO("testing udp reliable socket", "[udp]") {
+  GIVEN("two reliable sockets on the loopback") {
+    hermes::udp::Reliable receiver("50503");
+    hermes::udp::Reliable sender;
+
+    WHEN("sending 100 messages") {
+      std::mutex mutex;
+      std::vector<std::string> received;
+
+      receiver.set_receive_handler([&](std::string message,
+                                       const asio::ip::udp::endpoint& from,
+                                       hermes::udp::Reliable& socket) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(message);
+      });
+      receiver.run();
+      sender.run();
+
+      for (int i = 0; i < 100; ++i)
+        sender.send(std::to_string(i), "127.0.0.1", "50503");
+
+      for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (received.size() == 100) break;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      REQUIRE(received.size() == 100);
+      for (int i = 0; i < 100; ++i) REQUIRE(received[i] == std::to_string(i));
+    }
+  }
+}
+
+SCENARIO("testing udp reliable socket on a lossy link", "[udp]") {
+  GIVEN("a relay on port 50534 losing datagrams on their way to 50535") {
+    Service service;
+    auto relay = Datagram::new_session(service);
+    asio::ip::udp::endpoint receiver_endpoint(
+        asio::ip::address::from_string("127.0.0.1"), 50535);
+    asio::ip::udp::endpoint sender_endpoint;
+    // decides from the sequence number and the attempt if a DATA datagram
+    // is lost.
+    std::function<bool(std::uint32_t, int)> lost;
+    std::map<std::uint32_t, int> attempts;
+
+    relay->bind(asio::ip::udp::endpoint(asio::ip::udp::v4(), 50534));
+    auto start = [&]() {
+      relay->set_read_handler([&](std::string datagram,
+                                  const asio::ip::udp::endpoint& from,
+                                  Datagram& socket) {
+        if (from == receiver_endpoint) {
+          socket.async_send_to(datagram, sender_endpoint);
+        } else {
+          sender_endpoint = from;
+          auto sequence = datagram[0] == 1
+                              ? get_integer<std::uint32_t>(datagram, 1)
+                              : 0;
+          if (datagram[0] != 1 or not lost(sequence, attempts[sequence]++))
+            socket.async_send_to(datagram, receiver_endpoint);
+        }
+        socket.async_receive();
+      });
+      relay->service().run();
+      relay->async_receive();
+    };
+
+    std::mutex mutex;
+    std::vector<std::string> received;
+    std::vector<std::string> failed;
+
+    auto wait = [&](std::size_t messages, std::size_t failures) {
+      for (int i = 0; i < 100; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (received.size() == messages and failed.size() == failures) break;
+      }
+    };
+
+    auto make = [&](hermes::udp::Reliable& receiver,
+                    hermes::udp::Reliable& sender) {
+      receiver.set_receive_handler([&](std::string message,
+                                       const asio::ip::udp::endpoint& from,
+                                       hermes::udp::Reliable& socket) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(message);
+      });
+      sender.set_failure_handler(
+          [&](std::string message, const asio::ip::udp::endpoint& to) {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed.push_back(message);
+          });
+      sender.set_retransmit_timeout(std::chrono::milliseconds(20));
+      sender.set_max_retransmits(2);
+      receiver.run();
+      sender.run();
+    };
+
+    WHEN("the first transmission of some messages is lost") {
+      hermes::udp::Reliable receiver("50535");
+      hermes::udp::Reliable sender;
+      lost = [](std::uint32_t sequence, int attempt) {
+        return sequence % 10 == 3 and attempt == 0;
+      };
+      start();
+      make(receiver, sender);
+
+      for (int i = 0; i < 50; ++i)
+        sender.send(std::to_string(i), "127.0.0.1", "50534");
+      wait(50, 0);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      // retransmitted and delivered in order.
+      REQUIRE(received.size() == 50);
+      REQUIRE(failed.empty());
+      std::size_t i = 0;
+      REQUIRE(std::all_of(received.begin(), received.end(),
+                          [&](const std::string& message) {
+                            return message == std::to_string(i++);
+                          }));
+    }
+
+    WHEN("a message is never delivered") {
+      hermes::udp::Reliable receiver("50535");
+      hermes::udp::Reliable sender;
+      lost = [](std::uint32_t sequence, int) { return sequence == 5; };
+      start();
+      make(receiver, sender);
+
+      for (int i = 0; i < 20; ++i)
+        sender.send(std::to_string(i), "127.0.0.1", "50534");
+      wait(19, 1);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      // the sender gives up, the receiver moves past the gap.
+      REQUIRE(failed == std::vector<std::string>{"5"});
+      REQUIRE(received.size() == 19);
+      std::size_t i = 0;
+      REQUIRE(std::all_of(received.begin(), received.end(),
+                          [&](const std::string& message) {
+                            if (i == 5) ++i;
+                            return message == std::to_string(i++);
+                          }));
+    }
+
+    WHEN("messages are lost in unordered mode") {
+      hermes::udp::Reliable receiver("50535", false);
+      hermes::udp::Reliable sender;
+      lost = [](std::uint32_t sequence, int attempt) {
+        return sequence == 5 or (sequence % 7 == 0 and attempt == 0);
+      };
+      start();
+      make(receiver, sender);
+
+      for (int i = 0; i < 20; ++i)
+        sender.send(std::to_string(i), "127.0.0.1", "50534");
+      wait(19, 1);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      REQUIRE(failed == std::vector<std::string>{"5"});
+      auto unique = received;
+      std::sort(unique.begin(), unique.end());
+      REQUIRE(received.size() == 19);
+      REQUIRE(std::unique(unique.begin(), unique.end()) == unique.end());
+      REQUIRE(std::find(unique.begin(), unique.end(), "5") == unique.end());
+    }
+
+    relay->close();
+  }
+}
+
+SCENARIO("testing udp server sessions", "[udp]") {
+  GIVEN("UDP server listenning on port 50505") {
+    hermes::udp::Server server("50505");
+
+    WHEN("two peers send datagrams, the first one being promoted") {
+      std::atomic<int> accepted(0);
+
+      server.set_promote_threshold(2);
+      server.set_accept_handler([&](hermes::udp::Session::session session) {
+        ++accepted;
+        // per-peer state lives in the session handler.
+        auto count = std::make_shared<int>(0);
+        session->set_read_handler(
+            [count](std::string datagram, hermes::udp::Session& session) {
+              session.send(datagram + ":" + std::to_string(++*count));
+            });
+      });
+      server.run();
+
+      Service service;
+      auto a = Datagram::new_session(service);
+      auto b = Datagram::new_session(service);
+      asio::ip::udp::endpoint endpoint(
+          asio::ip::address::from_string("127.0.0.1"), 50505);
+      asio::ip::udp::endpoint from;
+
+      a->connect(endpoint);
+      b->connect(endpoint);
+
+      for (int i = 1; i <= 3; ++i) {
+        a->send("a");
+        REQUIRE(a->receive_from(from) == "a:" + std::to_string(i));
+      }
+      b->send("b");
+      REQUIRE(b->receive_from(from) == "b:1");
+
+      REQUIRE(accepted == 2);
+      REQUIRE(server.sessions() == 2);
+      server.stop();
+    }
+
+    WHEN("a session is kept after the server is stopped") {
+      std::promise<hermes::udp::Session::session> accepted;
+
+      server.set_accept_handler([&](hermes::udp::Session::session session) {
+        accepted.set_value(session);
+      });
+      server.run();
+
+      Service service;
+      auto peer = Datagram::new_session(service);
+      peer->connect(asio::ip::udp::endpoint(
+          asio::ip::address::from_string("127.0.0.1"), 50505));
+      peer->send("a");
+
+      auto session = accepted.get_future().get();
+      REQUIRE(session->send("b") == 1);
+      server.stop();
+
+      // the session is detached from the sockets of the server.
+      REQUIRE(session->send("c") == 0);
+      session->close();
+      REQUIRE(session->received() == 1);
+    }
+  }
+}
+
+SCENARIO("testing non-blocking asynchronous connections", "[tcp]") {
+  GIVEN("TCP server listenning on port 50507") {
+    hermes::tcp::Server server("50507");
+    Service service;
+
+    asio::ip::tcp::resolver resolver(service.get());
+    asio::ip::tcp::endpoint endpoint =
+        *resolver.resolve(asio::ip::tcp::resolver::query("127.0.0.1", "50507"));
+
+    WHEN("opening 10 connections concurrently") {
+      std::atomic<int> accepted(0);
+      std::atomic<int> connected(0);
+      std::vector<Stream::session> sessions;
+
+      server.set_accept_handler([&](Stream::session) { ++accepted; });
+      std::thread iterative([&]() {
+        for (int i = 0; i < 10; ++i) server.run(false);
+      });
+
+      // async_connect returns immediately, all connections are in flight.
+      for (int i = 0; i < 10; ++i) {
+        sessions.push_back(Stream::new_session(service));
+        sessions.back()->async_connect(endpoint,
+                                       [&](Stream& stream) { ++connected; });
+      }
+
+      iterative.join();
+      for (int i = 0; i < 50 and connected != 10; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(accepted == 10);
+      REQUIRE(connected == 10);
+      service.stop();
+    }
+
+    WHEN("the connection is refused, the error handler is invoked") {
+      std::atomic<bool> failed(false);
+      auto session = Stream::new_session(service);
+      asio::ip::tcp::endpoint refused(endpoint.address(), 50599);
+
+      session->set_error_handler(
+          [&](const asio::error_code& error, Stream& stream) {
+            REQUIRE(error);
+            failed = true;
+          });
+      session->async_connect(refused);
+
+      for (int i = 0; i < 50 and not failed; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(failed);
+      REQUIRE(not session->is_connected());
+      service.stop();
+    }
+
+    WHEN("clients are destroyed before their name resolution completes") {
+      for (int i = 0; i < 20; ++i) {
+        // a port per client, the resolutions are not cached.
+        hermes::tcp::Client client("localhost", std::to_string(50600 + i));
+        client.async_connect();
+      }
+      // the resolutions complete once the clients and their services are
+      // gone.
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+      REQUIRE_FALSE(
+          hermes::network::Resolver::shared().resolve("localhost", "50599")
+              .empty());
+    }
+  }
+}
+
+SCENARIO("testing graceful asynchronous disconnection", "[tcp]") {
+  GIVEN("TCP server listenning on port 50508") {
+    hermes::tcp::Server server("50508");
+    Service service;
+
+    asio::ip::tcp::resolver resolver(service.get());
+    asio::ip::tcp::endpoint endpoint =
+        *resolver.resolve(asio::ip::tcp::resolver::query("127.0.0.1", "50508"));
+
+    WHEN("the queued messages are flushed before the half-close") {
+      std::string received;
+      std::atomic<bool> closed(false);
+
+      server.set_accept_handler([&](Stream::session connection) {
+        asio::error_code error;
+        // reads until the end-of-file sent by the half-close.
+        asio::read(connection->socket(), asio::dynamic_buffer(received),
+                   error);
+        REQUIRE(error == asio::error::eof);
+      });
+      std::thread iterative([&]() { server.run(false); });
+
+      auto session = Stream::new_session(service);
+      session->async_connect(endpoint, [&](Stream& stream) {
+        for (int i = 0; i < 100; ++i) stream.async_send("0123456789");
+        // called from an handler, never blocks.
+        stream.async_disconnect([&](Stream& stream) { closed = true; });
+      });
+
+      iterative.join();
+      for (int i = 0; i < 50 and not closed; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(closed);
+      REQUIRE(received.size() == 1000);
+      REQUIRE(not session->is_connected());
+      service.stop();
+    }
+
+    WHEN("the stream is closed with unread input") {
+      std::promise<void> sent;
+      std::atomic<bool> closed(false);
+      asio::error_code error, reply;
+
+      server.set_accept_handler([&](Stream::session connection) {
+        std::string received;
+        // never read by the client.
+        connection->send(std::string(20000, 'a'));
+        sent.set_value();
+        asio::read(connection->socket(), asio::dynamic_buffer(received),
+                   error);
+        // still readable by the client, unless it reset the connection.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        asio::write(connection->socket(), asio::buffer("bye", 3), reply);
+      });
+      std::thread iterative([&]() { server.run(false); });
+
+      auto session = Stream::new_session(service);
+      service.run();
+      session->connect(endpoint);
+      sent.get_future().get();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      session->async_disconnect([&](Stream& stream) { closed = true; });
+
+      iterative.join();
+      for (int i = 0; i < 50 and not closed; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      // the input is drained: the peer gets an end-of-file, not a reset.
+      REQUIRE(error == asio::error::eof);
+      REQUIRE(not reply);
+      REQUIRE(closed);
+      service.stop();
+    }
+
+    WHEN("disconnect is called from an handler of the stream") {
+      std::atomic<bool> disconnected(false);
+
+      server.set_accept_handler([](Stream::session connection) {});
+      std::thread iterative([&]() { server.run(false); });
+
+      auto session = Stream::new_session(service);
+      session->async_connect(endpoint, [&](Stream& stream) {
+        stream.disconnect();
+        disconnected = true;
+      });
+
+      iterative.join();
+      for (int i = 0; i < 50 and not disconnected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(disconnected);
+      service.stop();
+    }
+  }
+}
+
+SCENARIO("testing future-returning operations", "[tcp]") {
+  GIVEN("TCP server listenning on port 50509 and a client") {
+    hermes::tcp::Server server("50509");
+    hermes::tcp::Client client("127.0.0.1", "50509");
+
+    WHEN("the client is not connected, the futures hold the error") {
+      REQUIRE_THROWS(client.send_async("test").get());
+      REQUIRE_THROWS(client.receive_async().get());
+    }
+
+    WHEN("sending many messages then waiting on them in bulk") {
+      server.set_accept_handler([](Stream::session connection) {
+        std::string received;
+        while (received.size() < 50) received += connection->receive();
+        connection->send(received);
+      });
+      std::thread iterative([&]() { server.run(false); });
+
+      client.connect();
+      std::vector<std::future<std::size_t>> sends;
+      for (int i = 0; i < 10; ++i) sends.push_back(client.send_async("hello"));
+      auto response = client.receive_async();
+
+      for (auto& bytes : sends) REQUIRE(bytes.get() == 5);
+      REQUIRE(response.get().size() == 50);
+      iterative.join();
+    }
+
+    WHEN("reconnecting after a disconnection, the service is restarted") {
+      server.set_accept_handler([](Stream::session connection) {
+        connection->send(connection->receive());
+      });
+
+      for (int i = 0; i < 3; ++i) {
+        std::thread iterative([&]() { server.run(false); });
+        std::promise<void> connected;
+        auto ready = connected.get_future();
+
+        // synchronous connections, then an asynchronous one.
+        if (i < 2) {
+          client.connect();
+          connected.set_value();
+        } else {
+          client.async_connect([&](Stream&) { connected.set_value(); });
+        }
+        REQUIRE(ready.wait_for(std::chrono::seconds(5)) ==
+                std::future_status::ready);
+        REQUIRE(client.is_connected());
+
+        auto echoed = client.receive_async();
+        REQUIRE(client.send_async("hello").get() == 5);
+        REQUIRE(echoed.get() == "hello");
+        iterative.join();
+
+        client.disconnect();
+        REQUIRE_FALSE(client.is_connected());
+      }
+    }
+  }
+}
+
+SCENARIO("testing clients sharing a pool of services", "[tcp]") {
+  GIVEN("TCP server listenning on port 50510 and a pool of 2 services") {
+    hermes::tcp::Server server("50510");
+    ServicePool pool(2);
+
+    REQUIRE(pool.size() == 2);
+    REQUIRE(&pool.next() != &pool.next());
+
+    WHEN("20 clients share the 2 services") {
+      std::atomic<int> accepted(0);
+
+      server.set_accept_handler([&](Stream::session) { ++accepted; });
+      std::thread iterative([&]() {
+        for (int i = 0; i < 21; ++i) server.run(false);
+      });
+
+      {
+        std::vector<std::unique_ptr<hermes::tcp::Client>> clients;
+        for (int i = 0; i < 20; ++i) {
+          clients.emplace_back(
+              new hermes::tcp::Client("127.0.0.1", "50510", pool.next()));
+          clients.back()->connect();
+          REQUIRE(clients.back()->is_connected());
+        }
+        // the clients are destroyed, the shared services keep running.
+      }
+
+      hermes::tcp::Client client("127.0.0.1", "50510", pool.next());
+      std::atomic<bool> connected(false);
+      client.async_connect([&](Stream&) { connected = true; });
+
+      iterative.join();
+      for (int i = 0; i < 50 and not connected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(accepted == 21);
+      REQUIRE(connected);
+    }
+  }
+}
+
+SCENARIO("testing a pool of clients", "[tcp]") {
+  GIVEN("TCP server listenning on port 50511 and a pool of 2 clients") {
+    hermes::tcp::Server server("50511");
+    hermes::tcp::ClientPool pool(1, 2);
+    std::vector<Stream::session> sessions;
+
+    server.set_accept_handler(
+        [&](Stream::session session) { sessions.push_back(session); });
+    std::thread iterative([&]() {
+      for (int i = 0; i < 2; ++i) server.run(false);
+    });
+
+    WHEN("checking out clients") {
+      auto first = pool.checkout("127.0.0.1", "50511");
+      auto second = pool.checkout("127.0.0.1", "50511");
+
+      REQUIRE(first->is_connected());
+      REQUIRE(second->is_alive());
+      REQUIRE(pool.size("127.0.0.1", "50511") == 2);
+      REQUIRE_THROWS_AS(pool.checkout("127.0.0.1", "50511",
+                                      std::chrono::milliseconds(100)),
+                        hermes::core::Error::Connection);
+
+      first.release();
+      REQUIRE(pool.idle("127.0.0.1", "50511") == 1);
+
+      auto third = pool.checkout("127.0.0.1", "50511");
+      REQUIRE(third->is_connected());
+      REQUIRE(pool.idle("127.0.0.1", "50511") == 0);
+
+      third.discard();
+      REQUIRE(pool.size("127.0.0.1", "50511") == 1);
+
+      iterative.join();
+      REQUIRE(sessions.size() == 2);
+    }
+  }
+}
+
+SCENARIO("testing a reconnecting client", "[tcp]") {
+  GIVEN("a reconnecting client to port 50512, while the server is down") {
+    hermes::tcp::Client client("127.0.0.1", "50512");
+    client.enable_reconnect(2, Backoff(std::chrono::milliseconds(10),
+                                       std::chrono::milliseconds(50)));
+
+    WHEN("sending while the server is down") {
+      client.send("a");
+      client.async_send("b");
+      // the buffer is full, the message is dropped.
+      client.send("c");
+
+      REQUIRE(client.buffered() == 2);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      REQUIRE_FALSE(client.is_connected());
+
+      hermes::tcp::Server server("50512");
+      std::string received;
+
+      server.set_accept_handler([&](Stream::session session) {
+        while (received.size() < 2) received += session->receive();
+      });
+      server.run(false);
+
+      REQUIRE(received == "ab");
+      REQUIRE(client.is_connected());
+      REQUIRE(client.buffered() == 0);
+    }
+  }
+
+  GIVEN("a backoff of 100ms up to 400ms") {
+    Backoff backoff(std::chrono::milliseconds(100),
+                    std::chrono::milliseconds(400));
+
+    WHEN("retrying") {
+      auto first = backoff.next();
+      auto second = backoff.next();
+      auto third = backoff.next();
+      auto fourth = backoff.next();
+
+      REQUIRE(first.count() >= 50);
+      REQUIRE(first.count() <= 100);
+      REQUIRE(second.count() >= 100);
+      REQUIRE(second.count() <= 200);
+      REQUIRE(third.count() >= 200);
+      REQUIRE(fourth.count() <= 400);
+
+      backoff.reset();
+      REQUIRE(backoff.next().count() <= 100);
+    }
+  }
+}
+
+SCENARIO("testing multiplexed requests", "[tcp]") {
+  GIVEN("TCP server listenning on port 50513 and a multiplexer") {
+    hermes::tcp::Server server("50513");
+    hermes::tcp::Multiplexer multiplexer("127.0.0.1", "50513");
+    std::vector<std::pair<std::string, std::function<void(const std::string&)>>>
+        requests;
+
+    // the server answers the first 3 requests in the reverse order.
+    server.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            requests.emplace_back(request, respond);
+            if (requests.size() == 3)
+              for (auto it = requests.rbegin(); it != requests.rend(); ++it)
+                it->second("re: " + it->first);
+          });
+    });
+
+    WHEN("sending many requests on one connection") {
+      std::thread iterative([&]() { server.run(false); });
+      multiplexer.connect();
+      iterative.join();
+
+      REQUIRE(multiplexer.is_connected());
+
+      auto first = multiplexer.request("first");
+      auto second = multiplexer.request("second");
+      auto third = multiplexer.request(std::string(5000, 'x'));
+
+      REQUIRE(third.get() == "re: " + std::string(5000, 'x'));
+      REQUIRE(second.get() == "re: second");
+      REQUIRE(first.get() == "re: first");
+      REQUIRE(multiplexer.in_flight() == 0);
+
+      std::promise<asio::error_code> cancelled;
+      auto id = multiplexer.request(
+          "fourth", [&](const asio::error_code& error, std::string) {
+            cancelled.set_value(error);
+          });
+
+      REQUIRE(multiplexer.cancel(id));
+      REQUIRE_FALSE(multiplexer.cancel(id));
+      REQUIRE(cancelled.get_future().get() == asio::error::operation_aborted);
+
+      multiplexer.disconnect();
+      REQUIRE_THROWS(multiplexer.request("fifth").get());
+    }
+
+    WHEN("reconnecting after a disconnection, the service is restarted") {
+      server.set_accept_handler([](Stream::session session) {
+        hermes::tcp::Multiplexer::serve(
+            session, [](std::string request,
+                        std::function<void(const std::string&)> respond) {
+              respond("re: " + request);
+            });
+      });
+
+      for (int i = 0; i < 3; ++i) {
+        std::thread iterative([&]() { server.run(false); });
+        std::promise<asio::error_code> connected;
+        auto ready = connected.get_future();
+
+        // synchronous connections, then an asynchronous one.
+        if (i < 2) {
+          multiplexer.connect();
+          connected.set_value(asio::error_code());
+        } else {
+          multiplexer.async_connect([&](const asio::error_code& error) {
+            connected.set_value(error);
+          });
+        }
+        REQUIRE(ready.wait_for(std::chrono::seconds(5)) ==
+                std::future_status::ready);
+        REQUIRE_FALSE(ready.get());
+        iterative.join();
+
+        auto response = multiplexer.request("ping");
+        REQUIRE(response.wait_for(std::chrono::seconds(5)) ==
+                std::future_status::ready);
+        REQUIRE(response.get() == "re: ping");
+
+        multiplexer.disconnect();
+        REQUIRE_FALSE(multiplexer.is_connected());
+      }
+    }
+
+    WHEN("the server announces a frame larger than the maximum") {
+      server.set_accept_handler([](Stream::session session) {
+        std::string header;
+        char request[hermes::tcp::Multiplexer::HEADER_SIZE + 5];
+        // answers the first request.
+        asio::read(session->socket(), asio::buffer(request, sizeof(request)));
+        put_integer(header, std::uint32_t(0xffffffff));
+        put_integer(header, std::uint64_t(0));
+        session->send(header);
+      });
+      std::thread iterative([&]() { server.run(false); });
+      multiplexer.connect();
+
+      std::promise<asio::error_code> failed;
+      multiplexer.request("first", [&](const asio::error_code& error,
+                                       std::string) { failed.set_value(error); });
+      iterative.join();
+
+      // the frame is not buffered, the connection is closed.
+      REQUIRE(failed.get_future().get() == asio::error::message_size);
+      REQUIRE(not multiplexer.is_connected());
+    }
+
+    WHEN("multiplexers are destroyed while connecting asynchronously") {
+      std::atomic<int> completed(0);
+
+      for (int i = 0; i < 20; ++i) {
+        // a port per multiplexer, the resolutions are not cached.
+        hermes::tcp::Multiplexer connecting("localhost",
+                                            std::to_string(50600 + i));
+        connecting.async_connect(
+            [&](const asio::error_code&) { ++completed; });
+      }
+      // the resolutions complete once the multiplexers and their services
+      // are gone, the completions are dropped.
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+      REQUIRE(completed <= 20);
+      REQUIRE_FALSE(multiplexer.is_connected());
+    }
+  }
+}
+
+SCENARIO("testing the cached name resolution", "[tcp]") {
+  GIVEN("a resolver with a time to live of 200ms") {
+    hermes::network::Resolver resolver(std::chrono::milliseconds(200));
+
+    WHEN("resolving a host twice") {
+      auto endpoints = resolver.resolve("127.0.0.1", "50514");
+
+      REQUIRE(endpoints.size() >= 1);
+      REQUIRE(endpoints.front().port() == 50514);
+
+      // the second resolution is served from the cache, from the I/O thread
+      // of the resolver, where resolve does not wait for itself.
+      std::promise<bool> cached;
+      auto caller = std::this_thread::get_id();
+      resolver.async_resolve(
+          "127.0.0.1", "50514",
+          [&](const asio::error_code& error,
+              const hermes::network::Resolver::endpoints& result) {
+            cached.set_value(
+                not error and result == endpoints and
+                std::this_thread::get_id() != caller and
+                resolver.resolve("127.0.0.1", "50514") == endpoints and
+                resolver.resolve("127.0.0.1", "50515").size() >= 1);
+          });
+      REQUIRE(cached.get_future().get());
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      REQUIRE(resolver.resolve("127.0.0.1", "50514") == endpoints);
+    }
+
+    WHEN("resolving an invalid host") {
+      REQUIRE_THROWS(resolver.resolve("invalid.host.hermes.", "50514"));
+    }
+  }
+
+  GIVEN("TCP server listenning on port 50514 and a client given endpoints") {
+    hermes::tcp::Server server("50514");
+    hermes::tcp::Client client(
+        hermes::network::Resolver::shared().resolve("127.0.0.1", "50514"));
+
+    WHEN("connecting the client") {
+      std::thread iterative([&]() { server.run(false); });
+      client.connect();
+      iterative.join();
+
+      REQUIRE(client.is_connected());
+    }
+  }
+}
+
+SCENARIO("testing client-side load balancing", "[tcp]") {
+  GIVEN("TCP servers listenning on ports 50515 and 50516, 50599 is down") {
+    hermes::tcp::Server fast("50515");
+    hermes::tcp::Server slow("50516");
+    std::atomic<int> fast_requests(0);
+    std::atomic<int> slow_requests(0);
+
+    fast.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            ++fast_requests;
+            respond(request);
+          });
+    });
+
+    // the slow server answers after 20ms.
+    slow.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            ++slow_requests;
+            std::thread([request, respond]() {
+              std::this_thread::sleep_for(std::chrono::milliseconds(20));
+              respond(request);
+            }).detach();
+          });
+    });
+
+    std::vector<std::pair<std::string, std::string>> servers = {
+        {"127.0.0.1", "50515"}, {"127.0.0.1", "50516"}, {"127.0.0.1", "50599"}};
+
+    std::thread iterative([&]() {
+      fast.run(false);
+      slow.run(false);
+    });
+
+    WHEN("balancing on the latency") {
+      hermes::tcp::BalancedClient client(servers,
+                                         hermes::tcp::BalancedClient::LATENCY);
+      client.connect();
+      iterative.join();
+
+      // the server down is ejected.
+      REQUIRE(client.healthy() == 2);
+
+      for (int i = 0; i < 20; ++i)
+        REQUIRE(client.request(std::to_string(i)).get() == std::to_string(i));
+
+      // the slow server is avoided once its latency is known.
+      REQUIRE(fast_requests + slow_requests == 20);
+      REQUIRE(slow_requests <= 2);
+    }
+
+    WHEN("the ejection of the server down has expired") {
+      hermes::tcp::BalancedClient client(servers);
+      client.set_ejection(1, std::chrono::milliseconds(10));
+      client.connect();
+      iterative.join();
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+      // the server down is reconnected in background, never picked.
+      for (int i = 0; i < 20; ++i)
+        REQUIRE(client.request(std::to_string(i)).get() == std::to_string(i));
+
+      // a client without server is refused.
+      REQUIRE_THROWS(hermes::tcp::BalancedClient({}));
+    }
+  }
+
+  GIVEN("TCP servers listenning on ports 50536 and 50537, the connections to "
+        "50536 being dropped") {
+    hermes::tcp::Server dropping("50536");
+    hermes::tcp::Server steady("50537");
+    std::vector<Stream::session> sessions;
+    std::mutex mutex;
+    std::atomic<bool> stopped(false);
+    std::atomic<bool> done(false);
+    std::atomic<int> answered(0);
+    std::atomic<int> stuck(0);
+
+    auto echo = [](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [](std::string request,
+                      std::function<void(const std::string&)> respond) {
+            respond(request);
+          });
+    };
+    dropping.set_accept_handler([&](Stream::session session) {
+      std::lock_guard<std::mutex> lock(mutex);
+      sessions.push_back(session);
+      echo(session);
+    });
+    steady.set_accept_handler(echo);
+
+    // the servers accept the reconnections until stopped.
+    std::thread accepting([&]() {
+      while (not stopped) dropping.run(false);
+    });
+    std::thread accepting_steady([&]() {
+      while (not stopped) steady.run(false);
+    });
+
+    hermes::tcp::BalancedClient client(
+        {{"127.0.0.1", "50536"}, {"127.0.0.1", "50537"}});
+    client.set_ejection(1, std::chrono::milliseconds(5));
+
+    // shuts down the connections accepted, from the strand of the server.
+    auto drop = [&]() {
+      while (not done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& session : sessions)
+          session->service().get_strand().post([session]() {
+            asio::error_code ignored;
+            session->socket().shutdown(asio::ip::tcp::socket::shutdown_both,
+                                       ignored);
+          });
+        sessions.clear();
+      }
+    };
+
+    // sends requests from several threads, a request never answered nor
+    // failed within 5 seconds is stuck.
+    auto load = [&]() {
+      std::vector<std::thread> callers;
+
+      for (int i = 0; i < 4; ++i)
+        callers.push_back(std::thread([&]() {
+          for (int j = 0; j < 500; ++j) {
+            auto response = client.request("ping");
+            if (response.wait_for(std::chrono::seconds(5)) !=
+                std::future_status::ready) {
+              ++stuck;
+              return;
+            }
+            try {
+              response.get();
+              ++answered;
+            } catch (std::exception&) {
+            }
+          }
+        }));
+      for (auto& caller : callers) caller.join();
+    };
+
+    auto shutdown = [&]() {
+      asio::io_context io_context;
+
+      stopped = true;
+      for (const char* port : {"50536", "50537"}) {
+        asio::ip::tcp::socket socket(io_context);
+        asio::error_code ignored;
+        socket.connect(asio::ip::tcp::endpoint(
+                           asio::ip::address::from_string("127.0.0.1"),
+                           static_cast<unsigned short>(std::stoi(port))),
+                       ignored);
+      }
+      accepting.join();
+      accepting_steady.join();
+    };
+
+    WHEN("requests are sent while a server drops its connections") {
+      client.connect();
+      std::thread dropper(drop);
+      load();
+      done = true;
+      dropper.join();
+
+      // the reconnections never block the requests, nor the client.
+      REQUIRE(stuck == 0);
+      REQUIRE(answered > 0);
+      REQUIRE(client.healthy() <= 2);
+      client.disconnect();
+      shutdown();
+    }
+
+    WHEN("hedged requests are sent while a server drops its connections") {
+      client.set_hedging(0.5, 0.5);
+      client.connect();
+      std::thread dropper(drop);
+      load();
+      done = true;
+      dropper.join();
+
+      REQUIRE(stuck == 0);
+      REQUIRE(answered > 0);
+      REQUIRE(client.healthy() <= 2);
+      client.disconnect();
+      shutdown();
+    }
+  }
+}
+
+SCENARIO("testing staggered connection attempts", "[tcp]") {
+  GIVEN("TCP server listenning on port 50518 and a session") {
+    hermes::tcp::Server server("50518");
+    Service service;
+    auto session = Stream::new_session(service);
+
+    asio::ip::tcp::endpoint server_endpoint(
+        asio::ip::address::from_string("127.0.0.1"), 50518);
+    asio::ip::tcp::endpoint refused(
+        asio::ip::address::from_string("127.0.0.1"), 50599);
+    // a non routable address, the attempt never completes or fails.
+    asio::ip::tcp::endpoint unreachable(
+        asio::ip::address::from_string("10.255.255.1"), 50518);
+
+    WHEN("the first addresses are unreachable or refuse the connection") {
+      std::thread iterative([&]() { server.run(false); });
+
+      auto start = std::chrono::steady_clock::now();
+      REQUIRE_NOTHROW(session->connect({unreachable, refused, server_endpoint},
+                                       std::chrono::milliseconds(100)));
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      iterative.join();
+
+      REQUIRE(session->is_connected());
+      REQUIRE(session->socket().remote_endpoint() == server_endpoint);
+      REQUIRE(elapsed < std::chrono::seconds(2));
+    }
+
+    WHEN("the session is connected from its I/O thread") {
+      std::thread iterative([&]() { server.run(false); });
+      std::promise<bool> connected;
+
+      service.run();
+      service.post([&]() {
+        session->connect({refused, server_endpoint});
+        connected.set_value(session->is_connected());
+      });
+
+      REQUIRE(connected.get_future().get());
+      iterative.join();
+      REQUIRE(session->socket().remote_endpoint() == server_endpoint);
+    }
+
+    WHEN("all the addresses refuse the connection") {
+      std::promise<asio::error_code> failed;
+
+      session->async_connect({refused, refused},
+                             [&](const asio::error_code& error) {
+                               failed.set_value(error);
+                             });
+
+      REQUIRE(failed.get_future().get() == asio::error::connection_refused);
+      REQUIRE_FALSE(session->is_connected());
+    }
+  }
+}
+
+SCENARIO("testing hedged requests", "[tcp]") {
+  GIVEN("TCP servers listenning on ports 50519 and 50520") {
+    hermes::tcp::Server steady("50519");
+    hermes::tcp::Server flaky("50520");
+
+    steady.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            respond(request);
+          });
+    });
+
+    // the flaky server answers the "slow" requests after 500ms.
+    flaky.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            if (request != "slow") return respond(request);
+            std::thread([request, respond]() {
+              std::this_thread::sleep_for(std::chrono::milliseconds(500));
+              respond(request);
+            }).detach();
+          });
+    });
+
+    std::thread iterative([&]() {
+      steady.run(false);
+      flaky.run(false);
+    });
+
+    hermes::tcp::BalancedClient client(
+        {{"127.0.0.1", "50519"}, {"127.0.0.1", "50520"}});
+    // a token per request: the hedges of the latencies observed cannot use
+    // up the budget of the slow requests.
+    client.set_hedging(0.95, 1);
+    client.connect();
+    iterative.join();
+
+    WHEN("a server is slow to answer") {
+      // the latencies are observed.
+      for (int i = 0; i < 40; ++i)
+        REQUIRE(client.request(std::to_string(i)).get() == std::to_string(i));
+
+      // the requests sent to the flaky server are answered by the other one.
+      for (int i = 0; i < 10; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(client.request("slow").get() == "slow");
+        REQUIRE(std::chrono::steady_clock::now() - start <
+                std::chrono::milliseconds(400));
+      }
+
+      REQUIRE(client.hedged() >= 1);
+    }
+  }
+}
+
+SCENARIO("testing the coalescing of identical requests", "[tcp]") {
+  GIVEN("TCP server listenning on port 50521 and a coalescer") {
+    hermes::tcp::Server server("50521");
+    hermes::tcp::Multiplexer multiplexer("127.0.0.1", "50521");
+    hermes::tcp::Coalescer<hermes::tcp::Multiplexer> coalescer(multiplexer);
+    std::atomic<int> received(0);
+
+    // the server answers after 100ms.
+    server.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            ++received;
+            std::thread([request, respond]() {
+              std::this_thread::sleep_for(std::chrono::milliseconds(100));
+              respond("re: " + request);
+            }).detach();
+          });
+    });
+
+    WHEN("many callers send the same request at the same time") {
+      std::thread iterative([&]() { server.run(false); });
+      multiplexer.connect();
+      iterative.join();
+
+      std::vector<std::future<std::string>> responses;
+      for (int i = 0; i < 5; ++i) responses.push_back(coalescer.request("a"));
+      auto other = coalescer.request("key", "b");
+
+      for (auto& response : responses) REQUIRE(response.get() == "re: a");
+      REQUIRE(other.get() == "re: b");
+      REQUIRE(received == 2);
+      REQUIRE(coalescer.coalesced() == 4);
+
+      // the request is sent again once completed.
+      REQUIRE(coalescer.request("a").get() == "re: a");
+      REQUIRE(received == 3);
+    }
+
+    WHEN("the coalescer is destroyed with a request in flight") {
+      std::thread iterative([&]() { server.run(false); });
+      multiplexer.connect();
+      iterative.join();
+
+      std::unique_ptr<hermes::tcp::Coalescer<hermes::tcp::Multiplexer>> other(
+          new hermes::tcp::Coalescer<hermes::tcp::Multiplexer>(multiplexer));
+      auto response = other->request("c");
+      other.reset();
+
+      REQUIRE(response.get() == "re: c");
+    }
+  }
+}
+
+SCENARIO("testing the client-side response cache", "[tcp]") {
+  GIVEN("TCP server listenning on port 50522 and a client with a cache") {
+    hermes::tcp::Server server("50522");
+    hermes::tcp::Client client("127.0.0.1", "50522");
+    auto cache = std::make_shared<hermes::core::Cache>(1);
+    auto line = hermes::tcp::Client::ends_with("\n");
+    std::atomic<int> received(0);
+
+    client.set_cache(cache);
+    // the responses are sent in two parts.
+    server.set_accept_handler([&](Stream::session session) {
+      while (received < 4) {
+        auto request = session->receive();
+        ++received;
+        session->send("re: ");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        session->send(request + "\n");
+      }
+    });
+
+    WHEN("sending requests") {
+      std::thread iterative([&]() { server.run(false); });
+      client.connect();
+
+      REQUIRE(client.request("a", line) == "re: a\n");
+      REQUIRE(client.request("a", line) == "re: a\n");
+      // evicts the response to "a".
+      REQUIRE(client.request("b", line) == "re: b\n");
+      REQUIRE(client.request("a", line) == "re: a\n");
+      REQUIRE(client.request("key", "c", line) == "re: c\n");
+      REQUIRE(client.request("key", "d", line) == "re: c\n");
+
+      iterative.join();
+      REQUIRE(received == 4);
+      REQUIRE(cache->hits() == 2);
+      REQUIRE(cache->misses() == 4);
+      REQUIRE(cache->size() == 1);
+    }
+  }
+
+  GIVEN("a cache whose entries live 50ms") {
+    hermes::core::Cache cache(2, std::chrono::milliseconds(50));
+    std::string value;
+
+    WHEN("the entries expire") {
+      cache.put("a", "1");
+      REQUIRE(cache.get("a", value));
+      REQUIRE(value == "1");
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      REQUIRE_FALSE(cache.get("a", value));
+      REQUIRE(cache.size() == 0);
+
+      cache.put("b", "2");
+      cache.invalidate("b");
+      REQUIRE_FALSE(cache.get("b", value));
+    }
+  }
+}
+
+SCENARIO("testing the sharding of keys across servers", "[tcp]") {
+  GIVEN("TCP servers listenning on port 50523 and 50524, and a sharded client") {
+    hermes::tcp::Server a("50523");
+    hermes::tcp::Server b("50524");
+    hermes::tcp::ShardedClient client(
+        {{"127.0.0.1", "50523"}, {"127.0.0.1", "50524"}});
+    std::vector<std::string> keys;
+    std::map<std::string, std::string> servers;
+
+    for (int i = 0; i < 1000; ++i) keys.push_back("key" + std::to_string(i));
+    for (const auto& key : keys) servers[key] = client.server(key);
+
+    WHEN("mapping the keys") {
+      auto on_a = std::count_if(
+          keys.begin(), keys.end(), [&](const std::string& key) {
+            return servers[key] == "127.0.0.1:50523";
+          });
+
+      // the keys are spread across the servers.
+      REQUIRE(client.size() == 2);
+      REQUIRE(on_a > 300);
+      REQUIRE(on_a < 700);
+    }
+
+    WHEN("adding and removing a server") {
+      std::size_t moved = 0;
+      std::size_t elsewhere = 0;
+
+      client.add("127.0.0.1", "50525");
+      for (const auto& key : keys) {
+        auto server = client.server(key);
+        if (server == "127.0.0.1:50525") ++moved;
+        else if (server != servers[key]) ++elsewhere;
+      }
+      // only the keys of the new server are remapped.
+      REQUIRE(elsewhere == 0);
+      REQUIRE(moved > 150);
+      REQUIRE(moved < 500);
+
+      client.remove("127.0.0.1", "50525");
+      REQUIRE(std::all_of(keys.begin(), keys.end(), [&](const std::string& key) {
+        return client.server(key) == servers[key];
+      }));
+    }
+
+    WHEN("sending a key to its server") {
+      std::string received;
+      std::string key = "key0";
+      auto& server = servers[key] == "127.0.0.1:50523" ? a : b;
+
+      server.set_accept_handler(
+          [&](Stream::session session) { received = session->receive(); });
+      std::thread iterative([&]() { server.run(false); });
+      client.get(key)->send(key);
+      iterative.join();
+
+      REQUIRE(received == key);
+    }
+  }
+}
+
+SCENARIO("testing replicated writes acknowledged by a quorum", "[tcp]") {
+  GIVEN("TCP servers listenning on ports 50526 and 50527, and one down") {
+    hermes::tcp::Server steady("50526");
+    hermes::tcp::Server stuck("50527");
+
+    steady.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            respond("ack " + request);
+          });
+    });
+
+    // the stuck server never answers the "slow" requests.
+    stuck.set_accept_handler([&](Stream::session session) {
+      hermes::tcp::Multiplexer::serve(
+          session, [&](std::string request,
+                       std::function<void(const std::string&)> respond) {
+            if (request != "slow") respond("ack " + request);
+          });
+    });
+
+    std::thread iterative([&]() {
+      steady.run(false);
+      stuck.run(false);
+    });
+
+    std::vector<std::pair<std::string, std::string>> replicas = {
+        {"127.0.0.1", "50526"}, {"127.0.0.1", "50527"}, {"127.0.0.1", "50599"}};
+    hermes::tcp::Replicator majority(replicas, 2,
+                                     std::chrono::milliseconds(200));
+    majority.connect();
+    iterative.join();
+
+    WHEN("a quorum of replicas acknowledges") {
+      auto acks = majority.send("a").get();
+
+      REQUIRE(acks.size() == 2);
+      REQUIRE(acks[0] == "ack a");
+      REQUIRE(acks[1] == "ack a");
+    }
+
+    WHEN("a replica does not answer") {
+      auto start = std::chrono::steady_clock::now();
+
+      REQUIRE_THROWS_AS(majority.send("slow").get(), asio::system_error);
+      REQUIRE(std::chrono::steady_clock::now() - start >=
+              std::chrono::milliseconds(200));
+    }
+
+    WHEN("the quorum cannot be reached") {
+      hermes::tcp::Replicator all(replicas, 3);
+      all.connect();
+
+      // fails without waiting for the timeout.
+      REQUIRE_THROWS_AS(all.send("a").get(), asio::system_error);
+      REQUIRE(all.quorum() == 3);
+
+      // the failure of the replica down is not reported from send.
+      std::promise<std::thread::id> failed;
+      all.send("b", [&](const asio::error_code&, std::vector<std::string>) {
+        failed.set_value(std::this_thread::get_id());
+      });
+      REQUIRE(failed.get_future().get() != std::this_thread::get_id());
+    }
+  }
+}
+
+SCENARIO("testing TCP Fast Open connections", "[tcp]") {
+  GIVEN("TCP server listenning on port 50528 with fast open") {
+    hermes::tcp::Server server("50528");
+    std::vector<std::string> received;
+
+    server.set_fast_open();
+    server.set_accept_handler([&](Stream::session session) {
+      received.push_back(session->receive());
+    });
+
+    WHEN("clients connect with fast open") {
+      // the first connection gets the cookie, the second one uses it.
+      for (const auto& message : {"first", "second"}) {
+        hermes::tcp::Client client("127.0.0.1", "50528");
+        std::thread iterative([&]() { server.run(false); });
+
+        client.set_fast_open(true);
+        client.connect();
+        REQUIRE(client.send(message) == std::string(message).size());
+        iterative.join();
+      }
+
+      REQUIRE(received.size() == 2);
+      REQUIRE(received[0] == "first");
+      REQUIRE(received[1] == "second");
+    }
+  }
+}
+
+SCENARIO("testing the socket options", "[tcp]") {
+  GIVEN("TCP server listenning on port 50529 with options") {
+    hermes::tcp::Server server("50529");
+    hermes::network::SocketOptions options;
+    asio::ip::tcp::no_delay server_no_delay;
+    asio::socket_base::keep_alive server_keep_alive;
+
+    options.no_delay = true;
+    options.keep_alive = true;
+    options.receive_buffer = 1 << 16;
+    options.user_timeout = std::chrono::seconds(5);
+    server.set_options(options);
+    server.set_accept_handler([&](Stream::session session) {
+      session->socket().get_option(server_no_delay);
+      session->socket().get_option(server_keep_alive);
+    });
+
+    WHEN("a session connects with options") {
+      hermes::core::Service service;
+      auto session = Stream::new_session(service);
+      asio::ip::tcp::no_delay no_delay;
+      asio::socket_base::receive_buffer_size receive_buffer;
+
+      std::thread iterative([&]() { server.run(false); });
+      session->set_options(options);
+      session->connect(asio::ip::tcp::endpoint(
+          asio::ip::address::from_string("127.0.0.1"), 50529));
+      iterative.join();
+
+      session->socket().get_option(no_delay);
+      session->socket().get_option(receive_buffer);
+
+      // the options are applied on both sides.
+      REQUIRE(no_delay.value());
+      REQUIRE(receive_buffer.value() >= 1 << 16);
+      REQUIRE(server_no_delay.value());
+      REQUIRE(server_keep_alive.value());
+      REQUIRE(session->options().user_timeout == std::chrono::seconds(5));
+
+#ifdef TCP_USER_TIMEOUT
+      // set through network::tcp_option.
+      int user_timeout = 0;
+      socklen_t size = sizeof(user_timeout);
+      ::getsockopt(session->socket().native_handle(), IPPROTO_TCP,
+                   TCP_USER_TIMEOUT, &user_timeout, &size);
+      REQUIRE(user_timeout == 5000);
+#endif
+    }
+  }
+}
+
+SCENARIO("testing the inline writes of async_send", "[tcp]") {
+  GIVEN("TCP server listenning on port 50530") {
+    hermes::tcp::Server server("50530");
+    std::string expected(8 << 20, 'x');
+    std::string received;
+    std::promise<void> done;
+
+    // larger than the socket buffer, partly written inline, then small
+    // messages written inline or queued behind it.
+    for (int i = 0; i < 1000; ++i) expected += std::to_string(1000 + i);
+
+    server.set_accept_handler([&](Stream::session session) {
+      session->set_read_handler([&](std::string data, Stream& stream) {
+        received += data;
+        if (received.size() < expected.size())
+          stream.async_receive();
+        else
+          done.set_value();
+      });
+      session->async_receive();
+    });
+
+    WHEN("sending messages without waiting for their completion") {
+      hermes::tcp::Client client("127.0.0.1", "50530");
+      std::thread iterative([&]() { server.run(false); });
+      std::vector<std::future<std::size_t>> sent;
+
+      client.connect();
+      iterative.join();
+      sent.push_back(client.send_async(expected.substr(0, 8 << 20)));
+      for (int i = 0; i < 1000; ++i)
+        sent.push_back(client.send_async(std::to_string(1000 + i)));
+
+      // the completions report the whole messages.
+      REQUIRE(sent[0].get() == std::size_t(8 << 20));
+      REQUIRE(std::all_of(sent.begin() + 1, sent.end(),
+                          [](std::future<std::size_t>& bytes) {
+                            return bytes.get() == 4;
+                          }));
+
+      // the messages are received in the order of the calls.
+      done.get_future().wait();
+      REQUIRE(received == expected);
+    }
+  }
+}
+
+SCENARIO("testing the batching of asynchronous sends", "[tcp]") {
+  GIVEN("TCP server listenning on port 50531") {
+    hermes::tcp::Server server("50531");
+    std::string expected = "header:body1:body2";
+    std::string received;
+    std::mutex mutex;
+    std::promise<void> done;
+
+    server.set_accept_handler([&](Stream::session session) {
+      session->set_read_handler([&](std::string data, Stream& stream) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received += data;
+        if (received.size() < expected.size())
+          stream.async_receive();
+        else
+          done.set_value();
+      });
+      session->async_receive();
+    });
+
+    WHEN("sending the pieces of a message in a batch") {
+      hermes::tcp::Client client("127.0.0.1", "50531");
+      std::thread iterative([&]() { server.run(false); });
+
+      client.connect();
+      iterative.join();
+
+      client.begin_batch();
+      auto header = client.send_async("header:");
+      client.async_send("body1:");
+      auto body = client.send_async("body2");
+
+      // nothing is sent before the flush.
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      REQUIRE(header.wait_for(std::chrono::seconds(0)) ==
+              std::future_status::timeout);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(received.empty());
+      }
+
+      client.flush();
+      REQUIRE(header.get() == 7);
+      REQUIRE(body.get() == 5);
+      done.get_future().wait();
+      REQUIRE(received == expected);
+
+      // out of a batch, the sends are written immediately.
+      REQUIRE(client.send_async("more").get() == 4);
+    }
+
+    WHEN("the stream is closed during a batch started before its connection") {
+      hermes::core::Service service;
+      auto session = Stream::new_session(service);
+      asio::ip::tcp::endpoint endpoint(
+          asio::ip::address::from_string("127.0.0.1"), 50531);
+      std::promise<asio::error_code> dropped;
+      std::promise<std::size_t> sent;
+
+      service.run();
+      session->begin_batch();
+      std::thread first([&]() { server.run(false); });
+      session->connect(endpoint);
+      first.join();
+
+#ifdef TCP_CORK
+      // the socket is corked at its connection.
+      int corked = 0;
+      socklen_t size = sizeof(corked);
+      ::getsockopt(session->socket().native_handle(), IPPROTO_TCP, TCP_CORK,
+                   &corked, &size);
+      REQUIRE(corked);
+#endif
+
+      session->async_send("dropped", [&](const asio::error_code& error,
+                                         std::size_t) {
+        dropped.set_value(error);
+      });
+      session->disconnect();
+      REQUIRE(dropped.get_future().get() == asio::error::operation_aborted);
+
+      // the batch is over, the next connection sends immediately.
+      std::thread second([&]() { server.run(false); });
+      session->connect(endpoint);
+      second.join();
+      session->async_send("sent", [&](const asio::error_code& error,
+                                      std::size_t bytes) {
+        sent.set_value(error ? 0 : bytes);
+      });
+      REQUIRE(sent.get_future().get() == 4);
+      session->disconnect();
+    }
+  }
+}
+
+#ifdef HERMES_COROUTINES
+SCENARIO("testing coroutine operations", "[tcp]") {
+  GIVEN("TCP server listenning on port 50506 and a client") {
+    hermes::tcp::Server server("50506");
+    hermes::tcp::Client client("127.0.0.1", "50506");
+
+    WHEN("writing an echo server and a client as straight-line code") {
+      std::atomic<bool> done(false);
+      std::string response;
+
+      auto echo = [&]() -> hermes::core::Task {
+        auto connection = co_await server.co_accept();
+        auto request = co_await connection->co_receive();
+        co_await connection->co_send(request);
+      };
+
+      auto ping = [&]() -> hermes::core::Task {
+        co_await client.co_connect();
+        co_await client.co_send("ping");
+        response = co_await client.co_receive();
+        done = true;
+      };
+
+      echo();
+      ping();
+
+      for (int i = 0; i < 50 and not done; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      REQUIRE(done);
+      REQUIRE(response == "ping");
+    }
+  }
+}
+#endif  // HERMES_COROUTINES
+
 SCENARIO("testing hermes protobuf operations", "[protobuf]") {
   GIVEN("protobuf message") {
       com::Message message;
@@ -606,3 +2394,130 @@ SCENARIO("testing hermes protobuf operations", "[protobuf]") {
 
   }
 }
+
+SCENARIO("testing hermes protobuf future-returning operations",
+         "[protobuf]") {
+  GIVEN("protobuf message") {
+    com::Message message;
+
+    message.set_name("aaaa");
+    message.set_object("bbbb");
+    message.set_from("cccc");
+    message.set_to("dddd");
+    message.set_msg("eeee");
+
+    WHEN("testing send_async and receive_async") {
+      auto result = hermes::protobuf::receive_async<com::Message>("50501");
+      auto bytes = hermes::protobuf::send_async<com::Message>("127.0.0.1",
+                                                             "50501", message);
+
+      REQUIRE(bytes.get() == 30);
+      REQUIRE(result.get().object() == "bbbb");
+    }
+
+    WHEN("testing send_async when the connection is refused") {
+      auto bytes = hermes::protobuf::send_async<com::Message>("127.0.0.1",
+                                                             "50599", message);
+      REQUIRE_THROWS(bytes.get());
+    }
+  }
+}
+
+SCENARIO("testing hermes protobuf operations over udp", "[protobuf]") {
+  GIVEN("protobuf message larger than a datagram fragment") {
+    com::Message message;
+
+    message.set_name("aaaa");
+    message.set_object("bbbb");
+    message.set_from("cccc");
+    message.set_to("dddd");
+    message.set_msg(std::string(5000, 'e'));
+
+    WHEN("testing fragmentation and reassembly out of order") {
+      std::string protobuf;
+      message.SerializeToString(&protobuf);
+
+      auto datagrams = hermes::protobuf::udp::fragment(protobuf);
+      REQUIRE(datagrams.size() == 4);
+
+      hermes::protobuf::udp::Reassembler reassembler;
+      asio::ip::udp::endpoint sender;
+      std::string result;
+
+      REQUIRE(not reassembler.feed(datagrams[3], sender, result));
+      REQUIRE(not reassembler.feed(datagrams[1], sender, result));
+      REQUIRE(not reassembler.feed(datagrams[1], sender, result));
+      REQUIRE(not reassembler.feed(datagrams[0], sender, result));
+      REQUIRE(reassembler.size() == 1);
+      REQUIRE(reassembler.feed(datagrams[2], sender, result));
+      REQUIRE(result == protobuf);
+      REQUIRE(reassembler.size() == 0);
+    }
+
+    WHEN("testing the bounds of the reassembly table") {
+      hermes::protobuf::udp::Reassembler reassembler(
+          2, std::chrono::milliseconds(50));
+      asio::ip::udp::endpoint sender;
+      std::string protobuf, result;
+      message.SerializeToString(&protobuf);
+
+      for (int i = 0; i < 3; ++i)
+        reassembler.feed(hermes::protobuf::udp::fragment(protobuf)[0], sender,
+                         result);
+      REQUIRE(reassembler.size() == 2);
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      reassembler.feed(hermes::protobuf::udp::fragment(protobuf)[0], sender,
+                       result);
+      REQUIRE(reassembler.size() == 1);
+
+      // a header announcing too many fragments is ignored.
+      auto forged = hermes::protobuf::udp::fragment(protobuf)[0];
+      forged[6] = forged[7] = '\xff';
+      REQUIRE(not reassembler.feed(forged, sender, result));
+      REQUIRE(reassembler.size() == 1);
+      REQUIRE_THROWS(hermes::protobuf::udp::fragment(std::string(
+          hermes::protobuf::udp::MAX_FRAGMENTS *
+                  hermes::protobuf::udp::FRAGMENT_SIZE +
+              1,
+          'a')));
+    }
+
+    WHEN("testing send and asynchronous receiver") {
+      std::atomic<bool> received(false);
+      std::string protobuf;
+      message.SerializeToString(&protobuf);
+
+      hermes::protobuf::udp::Receiver<com::Message> receiver(
+          "50504", [&](com::Message result) {
+            REQUIRE(result.msg() == message.msg());
+            received = true;
+          });
+
+      for (int i = 0; i < 50 and not received; ++i) {
+        REQUIRE(hermes::protobuf::udp::send<com::Message>(
+                    "127.0.0.1", "50504", message) == protobuf.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      REQUIRE(received);
+    }
+
+    WHEN("testing async_send and receive from 2 separate threads") {
+      std::promise<std::size_t> sent;
+      std::string protobuf;
+      message.SerializeToString(&protobuf);
+
+      std::thread a([&]() {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        hermes::protobuf::udp::async_send<com::Message>(
+            "127.0.0.1", "50504", message,
+            [&](std::size_t bytes) { sent.set_value(bytes); });
+      });
+
+      auto result = hermes::protobuf::udp::receive<com::Message>("50504");
+      REQUIRE(result.msg() == message.msg());
+      REQUIRE(sent.get_future().get() == protobuf.size());
+      a.join();
+    }
+  }
+}